@@ -26,9 +26,17 @@ end
 local function ldexp(x, exp)
 	return x * 2^exp
 end
+-- Scratch tables shared by pack/unpack. Requests arrive at ~40 Hz, so these
+-- are allocated once and overwritten by index rather than rebuilt per call.
+local pack_stream = {}
+local pack_bytes = {}
+local unpack_vars = {}
+local unpack_bytes = {}
+
 local function pack(format, ...)
-  local stream = {}
-  local vars = {...}
+  local stream = pack_stream
+  local n_stream = 0
+  local arg = 0
   local endianness = true
 
   for i = 1, format:len() do
@@ -40,21 +48,24 @@ local function pack(format, ...)
 	  endianness = false
 	elseif opt:find('[bBhHiIlL]') then
 	  local n = opt:find('[hH]') and 2 or opt:find('[iI]') and 4 or opt:find('[lL]') and 8 or 1
-	  local val = tonumber(table.remove(vars, 1))
+	  arg = arg + 1
+	  local val = tonumber((select(arg, ...)))
 
-	  local bytes = {}
+	  local bytes = pack_bytes
 	  for j = 1, n do
-		table.insert(bytes, string.char(val % (2 ^ 8)))
+		bytes[j] = string.char(val % (2 ^ 8))
 		val = math.floor(val / (2 ^ 8))
 	  end
 
+	  n_stream = n_stream + 1
 	  if not endianness then
-		table.insert(stream, string.reverse(table.concat(bytes)))
+		stream[n_stream] = string.reverse(table.concat(bytes, "", 1, n))
 	  else
-		table.insert(stream, table.concat(bytes))
+		stream[n_stream] = table.concat(bytes, "", 1, n)
 	  end
 	elseif opt:find('[fd]') then
-	  local val = tonumber(table.remove(vars, 1))
+	  arg = arg + 1
+	  local val = tonumber((select(arg, ...)))
 	  local sign = 0
 
 	  if val < 0 then
@@ -71,36 +82,44 @@ local function pack(format, ...)
 		exponent = exponent + ((opt == 'd') and 1022 or 126)
 	  end
 
-	  local bytes = {}
+	  local bytes = pack_bytes
+	  local n_bytes = 0
 	  if opt == 'd' then
 		val = mantissa
 		for i = 1, 6 do
-		  table.insert(bytes, string.char(math.floor(val) % (2 ^ 8)))
+		  n_bytes = n_bytes + 1
+		  bytes[n_bytes] = string.char(math.floor(val) % (2 ^ 8))
 		  val = math.floor(val / (2 ^ 8))
 		end
 	  else
-		table.insert(bytes, string.char(math.floor(mantissa) % (2 ^ 8)))
+		bytes[1] = string.char(math.floor(mantissa) % (2 ^ 8))
 		val = math.floor(mantissa / (2 ^ 8))
-		table.insert(bytes, string.char(math.floor(val) % (2 ^ 8)))
+		bytes[2] = string.char(math.floor(val) % (2 ^ 8))
 		val = math.floor(val / (2 ^ 8))
+		n_bytes = 2
 	  end
 
-	  table.insert(bytes, string.char(math.floor(exponent * ((opt == 'd') and 16 or 128) + val) % (2 ^ 8)))
+	  bytes[n_bytes + 1] = string.char(math.floor(exponent * ((opt == 'd') and 16 or 128) + val) % (2 ^ 8))
 	  val = math.floor((exponent * ((opt == 'd') and 16 or 128) + val) / (2 ^ 8))
-	  table.insert(bytes, string.char(math.floor(sign * 128 + val) % (2 ^ 8)))
+	  bytes[n_bytes + 2] = string.char(math.floor(sign * 128 + val) % (2 ^ 8))
 	  val = math.floor((sign * 128 + val) / (2 ^ 8))
+	  n_bytes = n_bytes + 2
 
+	  n_stream = n_stream + 1
 	  if not endianness then
-		table.insert(stream, string.reverse(table.concat(bytes)))
+		stream[n_stream] = string.reverse(table.concat(bytes, "", 1, n_bytes))
 	  else
-		table.insert(stream, table.concat(bytes))
+		stream[n_stream] = table.concat(bytes, "", 1, n_bytes)
 	  end
 	elseif opt == 's' then
-	  table.insert(stream, tostring(table.remove(vars, 1)))
-	  table.insert(stream, string.char(0))
+	  arg = arg + 1
+	  stream[n_stream + 1] = tostring((select(arg, ...)))
+	  stream[n_stream + 2] = string.char(0)
+	  n_stream = n_stream + 2
 	elseif opt == 'c' then
 	  local n = format:sub(i + 1):match('%d+')
-	  local str = tostring(table.remove(vars, 1))
+	  arg = arg + 1
+	  local str = tostring((select(arg, ...)))
 	  local len = tonumber(n)
 	  if len <= 0 then
 		len = str:len()
@@ -108,15 +127,19 @@ local function pack(format, ...)
 	  if len - str:len() > 0 then
 		str = str .. string.rep(' ', len - str:len())
 	  end
-	  table.insert(stream, str:sub(1, len))
+	  n_stream = n_stream + 1
+	  stream[n_stream] = str:sub(1, len)
 	  i = i + n:len()
 	end
   end
 
-  return table.concat(stream)
+  return table.concat(stream, "", 1, n_stream)
 end
+-- Unpacks into the shared unpack_vars table, returning the number of values
+-- written and the stream position after the last value read.
 local function unpack(format, stream, pos)
-  local vars = {}
+  local vars = unpack_vars
+  local n_vars = 0
   local iterator = pos or 1
   local endianness = true
 
@@ -133,7 +156,7 @@ local function unpack(format, stream, pos)
 
 	  local val = 0
 	  for j = 1, n do
-		local byte = string.byte(stream:sub(iterator, iterator))
+		local byte = string.byte(stream, iterator)
 		if endianness then
 		  val = val + byte * (2 ^ ((j - 1) * 8))
 		else
@@ -146,7 +169,8 @@ local function unpack(format, stream, pos)
 		val = val - 2 ^ (n * 8)
 	  end
 
-	  table.insert(vars, math.floor(val))
+	  n_vars = n_vars + 1
+	  vars[n_vars] = math.floor(val)
 	elseif opt:find('[fd]') then
 	  local n = (opt == 'd') and 8 or 4
 	  local x = stream:sub(iterator, iterator + n - 1)
@@ -167,41 +191,45 @@ local function unpack(format, stream, pos)
 	  end
 
 	  local exponent = (string.byte(x, n) % 128) * ((opt == 'd') and 16 or 2) + math.floor(string.byte(x, n - 1) / ((opt == 'd') and 16 or 128))
+	  n_vars = n_vars + 1
 	  if exponent == 0 then
-		table.insert(vars, 0.0)
+		vars[n_vars] = 0.0
 	  else
 		mantissa = (ldexp(mantissa, (opt == 'd') and -52 or -23) + 1) * sign
-		table.insert(vars, ldexp(mantissa, exponent - ((opt == 'd') and 1023 or 127)))
+		vars[n_vars] = ldexp(mantissa, exponent - ((opt == 'd') and 1023 or 127))
 	  end
 	elseif opt == 's' then
-	  local bytes = {}
+	  local bytes = unpack_bytes
+	  local n_bytes = 0
 	  for j = iterator, stream:len() do
-		if stream:sub(j,j) == string.char(0) or  stream:sub(j) == '' then
+		if string.byte(stream, j) == 0 then
 		  break
 		end
 
-		table.insert(bytes, stream:sub(j, j))
+		n_bytes = n_bytes + 1
+		bytes[n_bytes] = stream:sub(j, j)
 	  end
 
-	  local str = table.concat(bytes)
+	  local str = table.concat(bytes, "", 1, n_bytes)
 	  iterator = iterator + str:len() + 1
-	  table.insert(vars, str)
+	  n_vars = n_vars + 1
+	  vars[n_vars] = str
 	elseif opt == 'c' then
 	  local n = format:sub(i + 1):match('%d+')
 	  local len = tonumber(n)
 	  if len <= 0 then
-		len = table.remove(vars)
+		len = vars[n_vars]
+		n_vars = n_vars - 1
 	  end
 
-	  table.insert(vars, stream:sub(iterator, iterator + len - 1))
+	  n_vars = n_vars + 1
+	  vars[n_vars] = stream:sub(iterator, iterator + len - 1)
 	  iterator = iterator + len
 	  i = i + n:len()
 	end
   end
 
-  table.insert(vars, iterator)
-
-  return table.unpack(vars)
+  return n_vars, iterator
 end
 
 -- ==========================================
@@ -218,13 +246,18 @@ function Stream:new(stream)
 	return o
 end
 
+-- Rewinds the stream onto a new datagram so one Stream can serve every packet
+function Stream:reset(stream)
+	self.stream = stream
+	self.pos = 1
+end
+
 function Stream:read(format)
-	local results = {unpack(format, self.stream, self.pos)}
-	local n = #results
+	local n, pos = unpack(format, self.stream, self.pos)
 
 	-- Update position data
-	self.pos = results[n]
-	return table.unpack(results, 1, n - 1)
+	self.pos = pos
+	return table.unpack(unpack_vars, 1, n)
 end
 
 ----------------------------------------------
@@ -237,7 +270,9 @@ local UPDATE_MA_ENCODER = 0x8003
 local UPDATE_MA_MASTER = 0x8004
 local PRESS_MA_PLAYBACK_KEY = 0x8005
 local PRESS_MA_SYSTEM_KEY = 0x8006
-local PACKET_TYPE_END = 0x8007
+local ACK = 0x8007
+local HELLO = 0x8008 -- Startup handshake, the ACK tells the controller we are listening
+local PACKET_TYPE_END = 0x8009
 
 local KeyType_CLEAR = 0x10101010
 local KeyType_STORE = KeyType_CLEAR + 1
@@ -258,18 +293,122 @@ local EncoderType_None = 0x500
 ----------------------------------------------
 ----------------- Helpers --------------------
 ----------------------------------------------
+local function ClearTable(t)
+	for k in pairs(t) do
+		t[k] = nil
+	end
+end
+
+-- Persistent handle cache. Walking Root().ShowData.DataPools.Default.Pages for
+-- every poll and every fader write is the most expensive part of a request, so
+-- handles are resolved once and kept until the pages pool reports a change.
+-- Missing objects are cached as false so empty slots are not looked up again.
+local page_handles = {} -- [page] = page handle or false
+local executor_handles = {} -- [page] = { [Ptr index] = executor handle or false }
+
+local function GetPage(page_num)
+	local page = page_handles[page_num]
+	if page == nil then
+		-- Using 'default' datapool for now. Is this an issue in the future?
+		page = Root().ShowData.DataPools.Default.Pages:Ptr(page_num) or false
+		page_handles[page_num] = page
+	end
+	return page or nil
+end
+
+local function GetExecutor(page_num, index)
+	local executors = executor_handles[page_num]
+	if executors == nil then
+		executors = {}
+		executor_handles[page_num] = executors
+	end
+
+	local exec = executors[index]
+	if exec == nil then
+		local page = GetPage(page_num)
+		exec = page and page:Ptr(index) or false
+		executors[index] = exec
+	end
+	return exec or nil
+end
+
+-- Called from HookObjectChange whenever the pages pool is edited
+local function InvalidateHandleCache()
+	ClearTable(page_handles)
+	ClearTable(executor_handles)
+end
+
 local function GetEncoder(page_num, channel_num, encoderType)
-	local page = Root().ShowData.DataPools.Default.Pages:Ptr(page_num)
-	if not page then
-		return
+	return GetExecutor(page_num, channel_num + encoderType)
+end
+
+----------------------------------------------
+------------- Request scratch ----------------
+----------------------------------------------
+-- Everything REQ_ENCODERS touches is preallocated here and reused between
+-- requests, so a steady stream of polls does not feed MA's garbage collector.
+local requests = {} -- [1..8] = { page, channel }
+local arrbEncoderActive = {} -- [1..8] = 0 or 1
+local arrEncoders = {} -- [1..n_active] = { page, channel, unsafeEncoders }
+local response_parts = {}
+local get_fader_args = {} -- Argument tables for GetFader/SetFader, shared by every call
+local set_fader_args = { value = 0 }
+for i = 1, 8 do
+	requests[i] = { page = 0, channel = 0 }
+	arrbEncoderActive[i] = 0
+
+	local unsafeEncoders = {}
+	for j = 1, 4 do
+		unsafeEncoders[j] = { exec = nil, type = EncoderType_None }
 	end
-	local ch = page:Ptr(channel_num + encoderType)
-	if not ch then
-		return
+	arrEncoders[i] = { page = 0, channel = 0, unsafeEncoders = unsafeEncoders }
+end
+
+-- Write generations. SetFader only takes effect on the next DMX frame, so a
+-- GetFader straight after a write still returns the old value. Each write from
+-- the controller carries a generation; it is reported back with the executor's
+-- value once GetFader reflects the write, so the controller can tell stale
+-- feedback from the console's own changes. Keyed weakly by executor handle, so
+-- executors deleted from the show do not linger.
+local WRITE_MATCH_EPSILON = 0.1 -- GetFader is considered to reflect a write within this distance
+local WRITE_MAX_POLLS = 8 -- Report a write as applied after this many polls even if MA changed the value
+local weak_keys = { __mode = "k" }
+local applied_generation = setmetatable({}, weak_keys) -- [exec] = last generation reflected by GetFader
+local pending_generation = setmetatable({}, weak_keys) -- [exec] = generation of the last SetFader not yet reflected
+local pending_value = setmetatable({}, weak_keys)
+local pending_polls = setmetatable({}, weak_keys)
+local master_generation = { applied = 0, pending = nil, value = 0, polls = 0 }
+
+-- Returns the generation to report alongside `value`, the current GetFader of `exec`
+local function ReflectedGeneration(exec, value)
+	local pending = pending_generation[exec]
+	if pending then
+		local polls = pending_polls[exec] + 1
+		if math.abs(value - pending_value[exec]) < WRITE_MATCH_EPSILON or polls >= WRITE_MAX_POLLS then
+			applied_generation[exec] = pending
+			pending_generation[exec] = nil
+		else
+			pending_polls[exec] = polls
+		end
 	end
-	return ch
+	return applied_generation[exec] or 0
 end
 
+local function MasterReflectedGeneration(value)
+	local state = master_generation
+	if state.pending then
+		state.polls = state.polls + 1
+		if math.abs(value - state.value) < WRITE_MATCH_EPSILON or state.polls >= WRITE_MAX_POLLS then
+			state.applied = state.pending
+			state.pending = nil
+		end
+	end
+	return state.applied
+end
+
+-- Encoder types in the order they are stored in unsafeEncoders (400, 300, 200, 100)
+local EncoderTypeBySlot = { EncoderType_x400, EncoderType_x300, EncoderType_x200, EncoderType_x100 }
+
 ----------------------------------------------
 ------------------ Funcs ---------------------
 ----------------------------------------------
@@ -279,186 +418,163 @@ local function ExtractEncoderRequest(conn)
 	-- 	unsigned int channel;
 	-- } EncoderRequest[8];
 
-	local encoders = {}
-	local pages = {} -- Trak which pages have been requested (unique pages)
-
 	for i = 1, 8 do
 		local page, channel = conn.stream:read("<II")
 		-- Printf("Page: " .. tostring(page)   .. " Channel: " .. tostring(channel))
-		local req = {}
-		req["page"] = page
-		req["channel"] = channel
-		table.insert(encoders, req)
-
-		if not pages[page] then
-			pages[page] = true
-		end
+		local req = requests[i]
+		req.page = page
+		req.channel = channel
 	end
 
-	return encoders, pages
+	return requests
 end
 
-local function GetExecutersFromChannel(page, channel)
-	local _400, _300, _200, _100
-	local executerTable = {}
+-- Fills `slots` (indexed 400, 300, 200, 100) with the cached executors of the
+-- channel on page number `page`; slots without an executor have exec set to nil.
+local function GetExecutersFromChannel(page, channel, slots)
 	local bchActive = 0
 	for i = 0, 3 do
 		local channel_id = channel + (i * 100)
-		local executor = page:Ptr(channel_id)
+		local executor = GetExecutor(page, channel_id)
+		local slot = slots[4 - i]
+		slot.exec = executor
+		slot.type = EncoderTypeBySlot[4 - i]
 		if executor then
 			bchActive = 1
-			if i == 3 then
-				_400 = {}
-				_400["exec"] = executor
-				_400["type"] = EncoderType_x400
-			elseif i == 2 then
-				_300 = {}
-				_300["exec"] = executor
-				_300["type"] = EncoderType_x300
-			elseif i == 1 then
-				_200 = {}
-				_200["exec"] = executor
-				_200["type"] = EncoderType_x200
-			elseif i == 0 then
-				_100 = {}
-				_100["exec"] = executor
-				_100["type"] = EncoderType_x100
-			end
 		end
 	end
 
-	table.insert(executerTable, _400)
-	table.insert(executerTable, _300)
-	table.insert(executerTable, _200)
-	table.insert(executerTable, _100)
-
-	return bchActive, executerTable
+	return bchActive
 end
 
-local function PrepareEncoderData(connection, encoderObj)
+-- Appends the packed IPC::PlaybackRefresh::Data for one channel to response_parts
+local function PrepareEncoderData(connection, encoderObj, n_parts)
 	-- Printf("Preparing encoder data")
 	-- struct ChannelData  {
 	-- 	uint16_t page;
 	-- 	uint8_t channel; // eg x01, x02, x03
 	-- 	struct {
+	-- 		EncoderType type;
 	-- 		bool isActive;
 	-- 		char key_name[8];
 	-- 		float value;
+	-- 		uint32_t generation;
 	-- 	} Encoders[3]; // 4xx, 3xx, 2xx encoders
 	-- 	bool keysActive[4]; // 4xx, 3xx, 2xx, 1xx keys are being used
 	-- };
 	-- Printf("encoderObj -- page: " .. tostring(encoderObj.page) .. " channel: " .. tostring(encoderObj.channel))
-	local packet_data = pack("<HB", encoderObj.page, encoderObj.channel) 
+	n_parts = n_parts + 1
+	response_parts[n_parts] = pack("<HB", encoderObj.page, encoderObj.channel)
 
 	-- Encoders
 	for i=1, 3 do
 		-- Printf("Encoder index: " .. tostring(i))
 		local encoder = encoderObj.unsafeEncoders[i]
-		local exec = encoder["exec"]
-		if encoder == nil or exec["FADER"] == "" then
-			-- Printf("Encoder is nil on page " .. tostring(encoderObj.page) .. " channel " .. tostring(encoderObj.channel))
-			packet_data = packet_data .. pack("<HBc8f", EncoderType_None, 0, "        ", 0)
-			-- Printf("Encoder is nil on page " .. tostring(encoderObj.page) .. " channel " .. tostring(encoderObj.channel))
+		local exec = encoder.exec
+		n_parts = n_parts + 1
+		if exec == nil or exec["FADER"] == "" then
+			response_parts[n_parts] = pack("<HBc8fI", EncoderType_None, 0, "        ", 0, 0)
 		else
-			if exec["FADER"] == "" then
-				-- Printf("empty text")
-			end
-			-- Printf("Encoder is not nil on page " .. tostring(encoderObj.page) .. " channel " .. tostring(encoderObj.channel))
-			-- Printf("Encoder name: " .. encoder["FADER"] .. " value: " .. encoder:GetFader({}))
 			-- Printf("Encoder name: " .. exec["FADER"] .. " value: " .. exec:GetFader({}))
-			packet_data = packet_data .. pack("<HBc8f", encoder["type"] , 1, string.sub(exec["FADER"], 1, 8), exec:GetFader({}))
+			local value = exec:GetFader(get_fader_args)
+			response_parts[n_parts] = pack("<HBc8fI", encoder.type, 1, string.sub(exec["FADER"], 1, 8), value, ReflectedGeneration(exec, value))
 		end
 	end
 
 	-- keysActive
 	for i=1, 4 do
-		local encoder = encoderObj.unsafeEncoders[i]
-		if encoder == nil or encoder["exec"]["KEY"] == "" then
-			packet_data = packet_data .. pack("<B", 0)
+		local exec = encoderObj.unsafeEncoders[i].exec
+		n_parts = n_parts + 1
+		if exec == nil or exec["KEY"] == "" then
+			response_parts[n_parts] = pack("<B", 0)
 		else
-			packet_data = packet_data .. pack("<B", 1)
+			response_parts[n_parts] = pack("<B", 1)
 		end
 	end
 
-	return packet_data
+	return n_parts
 end
 
 local function HandleSendingEncoderData(connection, seq)
-	-- Collect all requests, and create a set of pages to request.
-	-- The later is to avoid loading the same page multiple times if 
-	-- the page is not valid.
-	local requests, unique_pages = ExtractEncoderRequest(connection)
-
-
-	-- Get all pages requested, and cache their pointers
-	local page_cache = {}
-	for k, v in pairs(unique_pages) do
-		-- Using 'default' datapool for now. Is this an issue in the future?
-		local page = Root().ShowData.DataPools.Default.Pages:Ptr(k)
-		page_cache[k] = page
-	end
+	-- Page and executor handles come from the persistent cache, so only the
+	-- first request after a show change walks the object tree.
+	local requests = ExtractEncoderRequest(connection)
 
 	-- Collect all encoder data
-	local arrbEncoderActive = {}
-	local arrEncoders = {}
-	for k, v in ipairs(requests) do
-		-- Printf("Processing request -- page " .. tostring(v["page"]) .. " channel " .. tostring(v["channel"]))
-		local page_ptr = page_cache[v["page"]]
-		if page_ptr == nil then
-			table.insert(arrbEncoderActive, 0)
+	local n_active = 0
+	for k = 1, 8 do
+		local v = requests[k]
+		-- Printf("Processing request -- page " .. tostring(v.page) .. " channel " .. tostring(v.channel))
+		arrbEncoderActive[k] = 0
+		if not GetPage(v.page) then
 			-- Printf("[" .. tostring(k) .. "] false")
 			goto continue
 		end
 
-		local bchActive, encoders = GetExecutersFromChannel(page_ptr, v["channel"])
-		table.insert(arrbEncoderActive, bchActive)
-		if bchActive == 1 then
-			local wrappedEncoder = {
-				page = v["page"],
-				channel = v["channel"],
-				unsafeEncoders = encoders -- May contain nil values
-			}
-			table.insert(arrEncoders, wrappedEncoder)
+		do
+			local wrappedEncoder = arrEncoders[n_active + 1]
+			local bchActive = GetExecutersFromChannel(v.page, v.channel, wrappedEncoder.unsafeEncoders)
+			arrbEncoderActive[k] = bchActive
+			if bchActive == 1 then
+				n_active = n_active + 1
+				wrappedEncoder.page = v.page
+				wrappedEncoder.channel = v.channel
+			end
 		end
-		
+
 		::continue::
   	end
 
 	-- ===========================================================
 	-- =================== IPC::IPCHeader ========================
 	-- ===========================================================
-	local packet_data = pack("<II", RESP_ENCODERS, seq) 
+	local n_parts = 1
+	response_parts[1] = pack("<II", RESP_ENCODERS, seq)
 
 	-- ===========================================================
 	-- ========= IPC::PlaybackRefresh::ChannelMetadata ===========
 	-- ===========================================================
-	packet_data = packet_data .. pack("<f", Root().ShowData.Masters.Grand.Master:GetFader({}))
-	for k, v in ipairs(arrbEncoderActive) do
-		packet_data = packet_data .. pack("<B", v)
+	n_parts = n_parts + 1
+	local master = Root().ShowData.Masters.Grand.Master:GetFader(get_fader_args)
+	response_parts[n_parts] = pack("<fI", master, MasterReflectedGeneration(master))
+	for k = 1, 8 do
+		n_parts = n_parts + 1
+		response_parts[n_parts] = pack("<B", arrbEncoderActive[k])
 	end
 
 	-- ===========================================================
 	-- =============== IPC::PlaybackRefresh::Data ================
 	-- ===========================================================
-	for k, v in ipairs(arrEncoders) do
-		packet_data = packet_data .. PrepareEncoderData(connection, v)
+	for k = 1, n_active do
+		n_parts = PrepareEncoderData(connection, arrEncoders[k], n_parts)
 	end
-	SendPacket(connection, packet_data)
+	SendPacket(connection, table.concat(response_parts, "", 1, n_parts))
 end
 
 local function HandleUpdatingLocalMasterEncoder(connection, seq)
-	local value = connection.stream:read("<f")
-	Root().ShowData.Masters.Grand.Master:SetFader({value=value})
+	local value, generation = connection.stream:read("<fI")
+	set_fader_args.value = value
+	Root().ShowData.Masters.Grand.Master:SetFader(set_fader_args)
+
+	local state = master_generation
+	state.pending = generation
+	state.value = value
+	state.polls = 0
 end
 
 local function HandleUpdatingLocalEncoder(connection, seq)
-	local _page, channel, encoderType, value = connection.stream:read("<HBHf")
+	local _page, channel, encoderType, value, generation = connection.stream:read("<HBHfI")
 	encoderType = encoderType - 100 -- Convert to 0-based index, kinda confusing
 	local ch = GetEncoder(_page, channel, encoderType)
 	if not ch then
 		return
 	end
-	ch:SetFader({value=value})
+	set_fader_args.value = value
+	ch:SetFader(set_fader_args)
+
+	pending_generation[ch] = generation
+	pending_value[ch] = value
+	pending_polls[ch] = 0
 end
 
 local function HandlePressingPlaybackKey(connection, seq)
@@ -512,17 +628,53 @@ local function HandlePressingSystemKey(connection, seq)
 
 end
 
+-- Heap growth per request, in KB as reported by collectgarbage("count").
+-- Enable ALLOC_TRACKING to confirm the request path stays allocation free;
+-- a report is printed every ALLOC_REPORT_INTERVAL requests of each type.
+local ALLOC_TRACKING = false
+local ALLOC_REPORT_INTERVAL = 400
+local alloc_stats = {}
+for pkt = REQ_ENCODERS, PACKET_TYPE_END - 1 do
+	alloc_stats[pkt] = { count = 0, total = 0, last = 0, max = 0 }
+end
+
+local function RecordAllocation(pkt_type, delta)
+	local stats = alloc_stats[pkt_type]
+	-- A negative delta means a collection ran mid-request; count it as zero
+	if delta < 0 then delta = 0 end
+	stats.count = stats.count + 1
+	stats.total = stats.total + delta
+	stats.last = delta
+	if delta > stats.max then stats.max = delta end
+
+	if stats.count >= ALLOC_REPORT_INTERVAL then
+		Printf(string.format("[alloc] packet 0x%x: avg %.3f KB/request, max %.3f KB over %d requests",
+			pkt_type, stats.total / stats.count, stats.max, stats.count))
+		stats.count = 0
+		stats.total = 0
+		stats.max = 0
+	end
+end
+
+-- One stream and connection object serve every datagram
+local stream = Stream:new("")
+local connection = {
+	conn = nil,
+	ip = nil,
+	port = nil,
+	stream = stream
+}
+
 local function HandleConnection(socket, ip, port, data)
 	if not data then return end
 
-	local stream = Stream:new(data)
-	local connection = {
-		conn = socket,
-		ip = ip,
-		port = port,
-		stream = stream
-	}
-	pkt_type, seq = stream:read("<II")
+	local heap_before = ALLOC_TRACKING and collectgarbage("count")
+
+	stream:reset(data)
+	connection.conn = socket
+	connection.ip = ip
+	connection.port = port
+	local pkt_type, seq = stream:read("<II")
 	-- Handlers
 	assert(
 		pkt_type >= REQ_ENCODERS and pkt_type < PACKET_TYPE_END,
@@ -538,15 +690,23 @@ local function HandleConnection(socket, ip, port, data)
 		HandlePressingPlaybackKey(connection, seq)
 	elseif pkt_type == PRESS_MA_SYSTEM_KEY then
 		HandlePressingSystemKey(connection, seq)
+	elseif pkt_type == HELLO then
+		Printf("Controller connected")
 	end
-end
 
-local function printmsg()
-	Printf("Change event")
+	-- Echo the sequence of anything that has no response of its own, so the
+	-- controller can measure round trip times and loss for every packet type
+	if pkt_type ~= REQ_ENCODERS then
+		SendPacket(connection, pack("<III", ACK, seq, pkt_type))
+	end
+
+	if heap_before then
+		RecordAllocation(pkt_type, collectgarbage("count") - heap_before)
+	end
 end
 
 local function BeginListening()
-	HookObjectChange(printmsg, Root().ShowData.DataPools.Default.Pages, my_handle:Parent())
+	HookObjectChange(InvalidateHandleCache, Root().ShowData.DataPools.Default.Pages, my_handle:Parent())
 
 	local socket = require("socket")
 	local udp = assert(socket.udp4())
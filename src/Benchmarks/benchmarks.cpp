@@ -0,0 +1,247 @@
+// Microbenchmarks for the controller hot paths. Results are written as JSON, one entry per benchmark,
+// so runs from two releases can be diffed, and summarised on stderr. Build with -DCMAKE_BUILD_TYPE=Release
+// for meaningful numbers.
+//
+//   BENCHMARKS [output.json]    (default benchmarks.json)
+//
+// Components run on a VirtualClock, so settle intervals and delays pass without sleeping.
+#include <x-touch.h>
+#include <interface.h>
+#include <ChannelGroup.h>
+#include <delayed.h>
+#include <mailbox.h>
+#include <startup.h>
+#include <clock.h>
+#include <latency.h>
+#include <metrics.h>
+#include <trace.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+XTouch *g_xtouch;
+DelayedExecuter *g_delayedThreadScheduler;
+InterfaceManager *g_interfaceManager;
+Mailbox *g_mailbox;
+StartupTimer *g_startup;
+Clock *g_clock;
+LatencyTracer *g_latency; // Tracing stays off, its cost is not part of the hot paths
+Metrics *g_metrics;
+Tracer *g_trace;
+
+// Private parts of ChannelGroup that are timed directly
+struct BenchmarkAccess {
+    static void GenerateChannelWindows(ChannelGroup &group) { group.GenerateChannelWindows(); }
+};
+
+namespace {
+    using real_clock = std::chrono::steady_clock; // Benchmarks are timed in real time, whatever g_clock is
+    constexpr double MIN_DURATION_NS = 200e6; // Each benchmark runs for at least this long
+
+    struct Result {
+        std::string name;
+        uint64_t iterations;
+        double nsPerOp;
+        double bytesPerOp; // Bytes sent to the X-Touch, 0 when nothing is sent
+    };
+    std::vector<Result> s_results;
+    uint64_t s_bytesSent = 0;
+
+    // Runs `fn(i)` in growing batches until MIN_DURATION_NS has passed
+    template<typename Fn>
+    void Measure(const char *name, Fn fn) {
+        uint64_t iterations = 0;
+        double elapsed = 0;
+        uint64_t bytes_before = s_bytesSent;
+        for(uint64_t batch = 16; elapsed < MIN_DURATION_NS; batch *= 2) {
+            auto start = real_clock::now();
+            for(uint64_t i = 0; i < batch; i++) { fn(iterations + i); }
+            elapsed += std::chrono::duration<double, std::nano>(real_clock::now() - start).count();
+            iterations += batch;
+        }
+        s_results.push_back({ name, iterations, elapsed / iterations, double(s_bytesSent - bytes_before) / iterations });
+        fprintf(stderr, "%-32s %12.1f ns/op %10.1f bytes/op\n", name, s_results.back().nsPerOp, s_results.back().bytesPerOp);
+    }
+
+    void BenchDecode() {
+        // Standalone decoder without callbacks, only the parsing is timed
+        XTouch decoder;
+        decoder.RegisterPacketSender([](unsigned char*, uint64_t) {});
+        decoder.SetPacketGap(std::chrono::microseconds(0));
+        struct Message {
+            const char *name;
+            std::vector<unsigned char> packet;
+        };
+        const Message messages[] = {
+            { "decode.fader", { 0xe3, 0x12, 0x40 } },
+            { "decode.fader_touch", { 0x90, 0x6a, 0x7f } },
+            { "decode.button", { 0x90, 0x2e, 0x7f } },
+            { "decode.dial", { 0xb0, 0x12, 0x41 } },
+            { "decode.jog", { 0xb0, 0x3c, 0x01 } },
+            { "decode.probe", { 0xf0, 0x00, 0x20, 0x32, 0x58, 0x54, 0x00, 0xf7 } },
+        };
+        for(auto &message : messages) {
+            auto packet = message.packet;
+            Measure(message.name, [&](uint64_t) { decoder.HandlePacket(packet.data(), packet.size()); });
+        }
+    }
+
+    void BenchEncode() {
+        Measure("encode.send_all_buttons", [](uint64_t) {
+            g_xtouch->ClearButtonLights();
+            g_xtouch->Flush();
+        });
+        Measure("encode.send_scribble", [](uint64_t i) {
+            xt_ScribblePad_t pad;
+            memset(&pad, 0, sizeof(pad));
+            snprintf(pad.TopText, sizeof(pad.TopText), "Exec%03u", unsigned(i % 1000));
+            snprintf(pad.BotText, sizeof(pad.BotText), "%u%%", unsigned(i % 100));
+            pad.Colour = static_cast<xt_colours_t>(i % 8);
+            g_xtouch->SetScribble(i % PHYSICAL_CHANNEL_COUNT, pad);
+            g_xtouch->Flush();
+        });
+        Measure("encode.send_segments", [](uint64_t i) {
+            g_xtouch->SetAssignment(i % 100);
+            g_xtouch->Flush();
+        });
+    }
+
+    // Sends what the controller loop would at the end of an iteration, so the repaint is part of the cost
+    void Repaint() {
+        g_interfaceManager->FlushLights();
+        g_xtouch->Flush();
+    }
+
+    // Settles the navigation started by the last press, applies it and repaints
+    void SettleNavigation(VirtualClock &clock, ChannelGroup &group) {
+        clock.Advance(std::chrono::milliseconds(NAVIGATION_SETTLE_INTERVAL));
+        group.FlushPendingInput();
+        Repaint();
+    }
+
+    void BenchNavigation(VirtualClock &clock, ChannelGroup &group) {
+        Measure("group.generate_channel_windows", [&](uint64_t) { BenchmarkAccess::GenerateChannelWindows(group); });
+        Measure("group.scroll_page", [&](uint64_t i) {
+            group.ScrollPage(i % 2 == 0 ? 1 : -1);
+            SettleNavigation(clock, group);
+        });
+        Measure("group.change_page", [&](uint64_t i) {
+            group.ChangePage(i % 2 == 0 ? 1 : -1);
+            SettleNavigation(clock, group);
+        });
+    }
+
+    // Two full responses for the channels on the surface, alternating makes every value and name change
+    void BenchRefresh(ChannelGroup &group) {
+        using namespace IPC::PlaybackRefresh;
+        constexpr uint32_t size = sizeof(IPC::IPCHeader) + sizeof(ChannelMetadata) + sizeof(Data) * PHYSICAL_CHANNEL_COUNT;
+        ChannelAddressSnapshot snapshot;
+        uint64_t version = group.CurrentChannelAddress(snapshot);
+
+        static char responses[2][size];
+        for(uint32_t r = 0; r < 2; r++) {
+            memset(responses[r], 0, size);
+            auto header = (IPC::IPCHeader*)responses[r];
+            header->type = IPC::PacketType::RESP_ENCODERS_META;
+            auto metadata = (ChannelMetadata*)(responses[r] + sizeof(IPC::IPCHeader));
+            metadata->master = r ? 80.0f : 20.0f;
+            auto data = (Data*)(responses[r] + sizeof(IPC::IPCHeader) + sizeof(ChannelMetadata));
+            for(uint32_t i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
+                metadata->channelActive[i] = true;
+                data[i].page = snapshot.channels[i].mainAddress;
+                data[i].channel = snapshot.channels[i].subAddress;
+                const EncoderType types[3] = { EncoderType::x400, EncoderType::x300, EncoderType::x200 };
+                for(uint32_t e = 0; e < 3; e++) {
+                    data[i].Encoders[e].type = types[e];
+                    data[i].Encoders[e].isActive = true;
+                    snprintf(data[i].Encoders[e].key_name, sizeof(data[i].Encoders[e].key_name), r ? "Dim %u" : "Fx %u", i);
+                    data[i].Encoders[e].value = r ? 75.0f : 25.0f;
+                }
+                for(auto &key : data[i].keysActive) { key = r == 1; }
+            }
+        }
+        Measure("group.apply_full_refresh", [&](uint64_t i) {
+            group.ApplyRefresh(responses[i % 2], size, version);
+            Repaint();
+        });
+        Measure("group.apply_unchanged_refresh", [&](uint64_t) {
+            group.ApplyRefresh(responses[0], size, version);
+            Repaint();
+        });
+    }
+
+    void BenchDelayed(VirtualClock &clock) {
+        auto &executer = *g_delayedThreadScheduler;
+        auto debounced = executer.Register([](float) {}, 25);
+        Measure("delayed.update", [&](uint64_t i) { executer.Update(debounced, i); });
+        executer.Unregister(debounced);
+
+        auto forced = executer.Register([](float) {}, 25);
+        Measure("delayed.forced_update", [&](uint64_t i) { executer.ForcedUpdate(forced, i); });
+        executer.Unregister(forced);
+
+        // Schedule a batch, jump past the deadline and wait for the executer thread to run every callback
+        constexpr uint32_t BATCH = 256;
+        std::atomic<uint32_t> fired{0};
+        std::vector<RegistrationId> ids;
+        for(uint32_t i = 0; i < BATCH; i++) { ids.push_back(executer.Register([&fired](float) { fired++; }, 1 + i % 16)); }
+        Measure("delayed.fire", [&](uint64_t i) {
+            uint32_t slot = i % BATCH;
+            executer.Update(ids[slot], i);
+            if (slot != BATCH - 1) { return; }
+            clock.Advance(std::chrono::milliseconds(16));
+            while (fired.load() < BATCH) { std::this_thread::yield(); }
+            fired = 0;
+        });
+        for(auto id : ids) { executer.Unregister(id); }
+    }
+
+    void WriteJson(FILE *out) {
+        fprintf(out, "{\n  \"build_type\": \"%s\",\n  \"benchmarks\": [\n", BENCHMARK_BUILD_TYPE);
+        for(size_t i = 0; i < s_results.size(); i++) {
+            auto &result = s_results[i];
+            fprintf(out, "    { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, \"bytes_per_op\": %.2f }%s\n",
+                result.name.c_str(), (unsigned long long)result.iterations, result.nsPerOp, result.bytesPerOp,
+                i + 1 < s_results.size() ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    auto clock = new VirtualClock();
+    g_clock = clock;
+    g_metrics = new Metrics();
+    g_startup = new StartupTimer();
+    g_xtouch = new XTouch();
+    g_xtouch->RegisterPacketSender([](unsigned char*, uint64_t len) { s_bytesSent += len; });
+    g_xtouch->SetPacketGap(std::chrono::microseconds(0)); // Only the encoding is timed, not the wire pacing
+    g_delayedThreadScheduler = new DelayedExecuter();
+    g_interfaceManager = new InterfaceManager(g_xtouch);
+    g_mailbox = new Mailbox();
+
+    // Cold start, without an MA server nothing is sent or polled
+    ChannelGroupConfig config;
+    config.stateFile = "";
+    auto group = new ChannelGroup(config);
+
+    BenchDecode();
+    BenchEncode();
+    BenchNavigation(*clock, *group);
+    BenchRefresh(*group);
+    BenchDelayed(*clock);
+
+    // Not stdout, the components log there
+    const char *path = argc > 1 ? argv[1] : "benchmarks.json";
+    FILE *out = fopen(path, "w");
+    if (out == nullptr) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+    WriteJson(out);
+    fclose(out);
+    return 0;
+}
@@ -5,6 +5,9 @@
 #include <assert.h>
 #include <maserver.h>
 #include <XController.h>
+#include <latency.h>
+#include <metrics.h>
+#include <trace.h>
 
 #define SERVER_PORT 9000
 #define SERVER_IP "127.0.0.1"
@@ -25,28 +28,117 @@ MaUDPServer::MaUDPServer() {
     timeout.tv_usec = 0;
 
     setsockopt (m_sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+
+    m_recv_thread = std::thread(&MaUDPServer::_recvthread, this);
+    m_recv_thread.detach();
 }
 
 ssize_t MaUDPServer::_sendimpl(const void *buf, size_t len) {
+    g_metrics->Add(Metric::MA_DATAGRAMS_OUT);
     return sendto(m_sockfd, buf, len, 0, (const struct sockaddr *)&m_server_addr, sizeof(m_server_addr));
 }
 
-ssize_t MaUDPServer::Send(char *data, uint32_t size) {
-    return _sendimpl(data, size);
+ssize_t MaUDPServer::Send(char *data, uint32_t size, uint32_t *seq) {
+    TraceSpan span("MaUDPServer::Send");
+    assert(size >= sizeof(IPC::IPCHeader));
+    IPC::IPCHeader *header = (IPC::IPCHeader*)data;
+    header->seq = m_nextSeq.fetch_add(1, std::memory_order_relaxed);
+    if (seq) { *seq = header->seq; }
+
+    m_roundTrip.Sent(header->type, header->seq);
+    auto sent = _sendimpl(data, size);
+    if (g_latency) { g_latency->Mark(LatencyStage::XT_MA_SEND); }
+    return sent;
 }
 ssize_t MaUDPServer::_recvimpl(void *buf, size_t len) {
-    socklen_t l = sizeof(m_server_addr);
-    return recvfrom(m_sockfd, buf, len, 0, (struct sockaddr *)&m_server_addr, &l);
+    struct sockaddr_in from; // Not m_server_addr, senders read that concurrently
+    socklen_t l = sizeof(from);
+    TraceSpan span("recvfrom");
+    return recvfrom(m_sockfd, buf, len, 0, (struct sockaddr *)&from, &l);
+}
+
+// Receives everything the plugin sends. ACKs are consumed here so their round trip
+// time is measured on arrival, anything else is queued for Read.
+void MaUDPServer::_recvthread() {
+    char buffer[PACKET_SIZE];
+    Tracer::NameThread("MA receive");
+    while (true) {
+        auto received = _recvimpl(buffer, sizeof(buffer));
+        if (received < (ssize_t)sizeof(IPC::IPCHeader)) { continue; } // Timeout, or runt packet
+        auto arrived = g_latency ? Clock::now() : Clock::time_point();
+        g_metrics->Add(Metric::MA_DATAGRAMS_IN);
+
+        IPC::IPCHeader *header = (IPC::IPCHeader*)buffer;
+        if (!m_ready.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(m_mutex_queue);
+            m_ready.store(true);
+            g_clock->NotifyAll(m_readyCondition);
+        }
+        if (header->type == IPC::PacketType::ACK) {
+            if (received < (ssize_t)(sizeof(IPC::IPCHeader) + sizeof(IPC::Ack::Data))) { continue; }
+            IPC::Ack::Data *ack = (IPC::Ack::Data*)(buffer + sizeof(IPC::IPCHeader));
+            if (ack->type < IPC::PacketType::REQ_ENCODERS || ack->type >= IPC::PacketType::END) { continue; }
+            m_roundTrip.Received(ack->type, header->seq);
+            continue;
+        }
+        if (header->type == IPC::PacketType::RESP_ENCODERS_META) {
+            m_roundTrip.Received(IPC::PacketType::REQ_ENCODERS, header->seq);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex_queue);
+        if (m_queueCount == QUEUE_SIZE) { // Nobody is reading, drop the oldest
+            m_queueHead = (m_queueHead + 1) % QUEUE_SIZE;
+            m_queueCount--;
+            g_metrics->Add(Metric::MA_RESPONSES_DROPPED);
+        }
+        auto &packet = m_queue[(m_queueHead + m_queueCount) % QUEUE_SIZE];
+        memcpy(packet.data, buffer, received);
+        packet.size = received;
+        packet.arrived = arrived;
+        m_queueCount++;
+        g_metrics->Set(Metric::MA_QUEUE_DEPTH, m_queueCount);
+        g_clock->NotifyOne(m_queueCondition);
+    }
+}
+
+ssize_t MaUDPServer::Read(char *data, uint32_t size, Clock::time_point *arrived) {
+    TraceSpan span("MaUDPServer::Read");
+    std::unique_lock<std::mutex> lock(m_mutex_queue);
+    if (!g_clock->WaitFor(m_queueCondition, lock, std::chrono::seconds(1), [this] { return m_queueCount > 0; })) {
+        return -1;
+    }
+
+    auto &packet = m_queue[m_queueHead];
+    m_queueHead = (m_queueHead + 1) % QUEUE_SIZE;
+    m_queueCount--;
+    g_metrics->Set(Metric::MA_QUEUE_DEPTH, m_queueCount);
+
+    ssize_t copied = packet.size < size ? packet.size : size;
+    memcpy(data, packet.data, copied);
+    if (arrived) { *arrived = packet.arrived; }
+    return copied;
+}
+
+bool MaUDPServer::Handshake(std::chrono::milliseconds timeout) {
+    if (m_ready.load()) { return true; }
+
+    IPC::IPCHeader header;
+    header.type = IPC::PacketType::HELLO;
+    header.seq = 0; // Stamped by Send
+    Send((char*)&header, sizeof(header));
+
+    std::unique_lock<std::mutex> lock(m_mutex_queue);
+    return g_clock->WaitFor(m_readyCondition, lock, timeout, [this] { return m_ready.load(); });
 }
 
-ssize_t MaUDPServer::Read(char *data, uint32_t size) {
-    return _recvimpl(data, size);
+void MaUDPServer::ReportLatency(FILE *out) {
+    m_roundTrip.Report(out);
 }
 
 void MaUDPServer::SendSystemButton(IPC::ButtonEvent::KeyType type, bool down) {
     IPC::IPCHeader header;
     header.type = IPC::PacketType::PRESS_MA_SYSTEM_KEY;
-    header.seq = 0;
+    header.seq = 0; // Stamped by Send
     IPC::ButtonEvent::SystemKeyDown event;
     event.key = type;
     event.down = down;
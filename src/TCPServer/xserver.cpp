@@ -3,6 +3,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <latency.h>
+#include <metrics.h>
+#include <trace.h>
 
 TCPServer::TCPServer(unsigned short port, PacketCallback cb) : m_cb(cb), m_port(port) {
     m_buffer =  (unsigned char *)malloc(BUFSIZE);
@@ -23,6 +26,7 @@ void TCPServer::Start() {
 
 void TCPServer::Send(unsigned char *buffer, unsigned int len) {
     sendto(m_socket.sockfd, buffer, len, 0, (struct sockaddr *) &(m_socket.clientaddr), (m_socket.clientlen));
+    g_metrics->Add(Metric::XT_DATAGRAMS_OUT);
 }
 
 void TCPServer::Bind() {
@@ -55,13 +59,20 @@ bool TCPServer::Alive() {
 
 void TCPServer::Read() {
     printf("Reader thread started\n");
+    Tracer::NameThread("X-Touch receive");
     while(Alive()) {
-        size_t recvlen = recvfrom(m_socket.sockfd, m_buffer, BUFSIZE, 0, (struct sockaddr *) &(m_socket.clientaddr), &(m_socket.clientlen));
+        size_t recvlen;
+        {
+            TraceSpan span("recvfrom");
+            recvlen = recvfrom(m_socket.sockfd, m_buffer, BUFSIZE, 0, (struct sockaddr *) &(m_socket.clientaddr), &(m_socket.clientlen));
+        }
         if (recvlen < 0) {
             printf("ERROR in recvfrom\n");
             SetDead();
             return;
         }
+        if (g_latency) { LatencyTracer::SetOrigin(Clock::now()); }
+        g_metrics->Add(Metric::XT_DATAGRAMS_IN);
         m_cb(m_buffer, recvlen);
     }
     printf("Reader thread dead\n");
@@ -0,0 +1,191 @@
+// Checks the arithmetic channel windows of ChannelGroup: which executor each unpinned physical channel
+// shows, how many windows a page has, and how the jog wheel's navigation target crosses pages.
+#include <x-touch.h>
+#include <interface.h>
+#include <ChannelGroup.h>
+#include <delayed.h>
+#include <mailbox.h>
+#include <startup.h>
+#include <clock.h>
+#include <latency.h>
+#include <metrics.h>
+#include <trace.h>
+#include <stdio.h>
+#include <initializer_list>
+
+XTouch *g_xtouch;
+DelayedExecuter *g_delayedThreadScheduler;
+InterfaceManager *g_interfaceManager;
+Mailbox *g_mailbox;
+StartupTimer *g_startup;
+Clock *g_clock;
+LatencyTracer *g_latency;
+Metrics *g_metrics;
+Tracer *g_trace;
+
+// Private parts of ChannelGroup driven directly
+struct ChannelWindowsAccess {
+    static void Pin(ChannelGroup &group, uint32_t physical, uint32_t page, uint32_t executor) {
+        Address address;
+        address.mainAddress = page;
+        address.subAddress = executor;
+        group.m_channels[physical].m_address->Set(address);
+        group.m_channels[physical].Pin(true);
+    }
+    static void UnpinAll(ChannelGroup &group) {
+        for(uint32_t i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) { group.m_channels[i].Pin(false); }
+    }
+    // Shows `page` and recomputes its windows, as navigation does
+    static void ShowPage(ChannelGroup &group, uint32_t page) {
+        group.m_page->Set(page);
+        group.m_channelOffset = 0;
+        group.GenerateChannelWindows();
+    }
+    static uint32_t WindowChannel(ChannelGroup &group, uint32_t window, uint32_t slot) { return group.WindowChannel(window, slot); }
+    static uint32_t WindowCount(ChannelGroup &group, uint32_t page) { return group.WindowCount(page); }
+    static uint32_t WindowWidth(ChannelGroup &group) { return group.m_windowWidth; }
+    static uint32_t LastWindow(ChannelGroup &group) { return group.m_channelOffsetEnd; }
+    // Moves a navigation target starting at `page`/`offset` by `windows`, returns where it lands
+    static void Move(ChannelGroup &group, uint32_t &page, uint32_t &offset, int32_t windows) {
+        group.m_navTarget = { page, offset };
+        group.MoveNavigationTarget(windows);
+        page = group.m_navTarget.page;
+        offset = group.m_navTarget.offset;
+    }
+};
+
+namespace {
+    using Access = ChannelWindowsAccess;
+
+    constexpr uint32_t PAGE_COUNT = 3;
+    constexpr uint32_t CHANNEL_COUNT = 15; // Two windows of 8, the second one short of an executor
+
+    bool s_passed = true;
+
+    void Expect(const char *what, uint32_t actual, uint32_t wanted) {
+        if (actual == wanted) { return; }
+        s_passed = false;
+        printf("%s: expected %u, got %u\n", what, wanted, actual);
+    }
+
+    // Expects the executors of `window`, UINT32_MAX for a slot past the end of the page
+    void ExpectWindow(ChannelGroup &group, const char *what, uint32_t window, std::initializer_list<uint32_t> executors) {
+        char name[128];
+        uint32_t slot = 0;
+        for(auto executor : executors) {
+            snprintf(name, sizeof(name), "%s, window %u slot %u", what, window, slot);
+            Expect(name, Access::WindowChannel(group, window, slot++), executor);
+        }
+    }
+
+    void ExpectMove(ChannelGroup &group, const char *what, uint32_t page, uint32_t offset, int32_t windows, uint32_t wantedPage, uint32_t wantedOffset) {
+        char name[128];
+        Access::Move(group, page, offset, windows);
+        snprintf(name, sizeof(name), "%s, page", what);
+        Expect(name, page, wantedPage);
+        snprintf(name, sizeof(name), "%s, window", what);
+        Expect(name, offset, wantedOffset);
+    }
+
+    void TestUnpinned(ChannelGroup &group) {
+        Access::UnpinAll(group);
+        Access::ShowPage(group, 1);
+        Expect("unpinned width", Access::WindowWidth(group), 8);
+        Expect("unpinned windows", Access::WindowCount(group, 1), 2);
+        Expect("unpinned last window", Access::LastWindow(group), 1);
+        ExpectWindow(group, "unpinned", 0, { 1, 2, 3, 4, 5, 6, 7, 8 });
+        ExpectWindow(group, "unpinned", 1, { 9, 10, 11, 12, 13, 14, 15, UINT32_MAX });
+    }
+
+    // Executor 3 of page 1 is pinned to the last physical channel
+    void TestPinnedOnPage(ChannelGroup &group) {
+        Access::UnpinAll(group);
+        Access::Pin(group, 7, 1, 3);
+        Access::ShowPage(group, 1);
+        Expect("pinned on page width", Access::WindowWidth(group), 7);
+        Expect("pinned on page windows", Access::WindowCount(group, 1), 2);
+        ExpectWindow(group, "pinned on page", 0, { 1, 2, 4, 5, 6, 7, 8 });
+        ExpectWindow(group, "pinned on page", 1, { 9, 10, 11, 12, 13, 14, 15 });
+        Expect("pinned on page, past the end", Access::WindowChannel(group, 2, 0), UINT32_MAX);
+    }
+
+    // The same pin seen from page 2 takes a physical channel but skips no executor
+    void TestPinnedOnOtherPage(ChannelGroup &group) {
+        Access::UnpinAll(group);
+        Access::Pin(group, 7, 1, 3);
+        Access::ShowPage(group, 2);
+        Expect("pinned elsewhere width", Access::WindowWidth(group), 7);
+        Expect("pinned elsewhere windows", Access::WindowCount(group, 2), 3);
+        Expect("pinned elsewhere last window", Access::LastWindow(group), 2);
+        ExpectWindow(group, "pinned elsewhere", 0, { 1, 2, 3, 4, 5, 6, 7 });
+        ExpectWindow(group, "pinned elsewhere", 2, { 15, UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX });
+        // WindowCount of another page does not disturb the current one
+        Expect("pinned elsewhere, windows of page 1", Access::WindowCount(group, 1), 2);
+        Expect("pinned elsewhere, width after counting page 1", Access::WindowWidth(group), 7);
+    }
+
+    void TestAllPinned(ChannelGroup &group) {
+        Access::UnpinAll(group);
+        for(uint32_t i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) { Access::Pin(group, i, 1, i + 1); }
+        Access::ShowPage(group, 1);
+        Expect("all pinned width", Access::WindowWidth(group), 0);
+        Expect("all pinned last window", Access::LastWindow(group), 0);
+        for(uint32_t page = 1; page <= PAGE_COUNT; page++) {
+            Expect("all pinned windows", Access::WindowCount(group, page), 1);
+        }
+        ExpectMove(group, "all pinned, one window per page", 1, 0, 2, 3, 0);
+        ExpectMove(group, "all pinned, back", 3, 0, -1, 2, 0);
+    }
+
+    void TestNavigation(ChannelGroup &group) {
+        // Every page has two windows
+        Access::UnpinAll(group);
+        Access::ShowPage(group, 1);
+        ExpectMove(group, "within the page", 1, 0, 1, 1, 1);
+        ExpectMove(group, "onto the next page", 1, 1, 1, 2, 0);
+        ExpectMove(group, "across a page", 1, 0, 5, 3, 1);
+        ExpectMove(group, "clamped at the last page", 2, 0, 10, PAGE_COUNT, 1);
+        ExpectMove(group, "at the last window", PAGE_COUNT, 1, 1, PAGE_COUNT, 1);
+        ExpectMove(group, "back within the page", 3, 1, -1, 3, 0);
+        ExpectMove(group, "back onto the previous page", 3, 0, -1, 2, 1);
+        ExpectMove(group, "back across a page", 3, 1, -5, 1, 0);
+        ExpectMove(group, "clamped at page 1", 2, 1, -10, 1, 0);
+        ExpectMove(group, "at the first window", 1, 0, -1, 1, 0);
+
+        // Page 1 keeps two windows while pages 2 and 3 need three
+        Access::Pin(group, 7, 1, 3);
+        ExpectMove(group, "pinned, onto a longer page", 1, 1, 1, 2, 0);
+        ExpectMove(group, "pinned, to the end of a longer page", 1, 1, 3, 2, 2);
+        ExpectMove(group, "pinned, back onto a longer page", 3, 0, -1, 2, 2);
+        ExpectMove(group, "pinned, back onto a shorter page", 2, 0, -1, 1, 1);
+        ExpectMove(group, "pinned, clamped at the last page", 1, 0, 100, PAGE_COUNT, 2);
+    }
+}
+
+int main(int, char**) {
+    g_clock = new VirtualClock();
+    g_metrics = new Metrics();
+    g_startup = new StartupTimer();
+    g_xtouch = new XTouch();
+    g_xtouch->RegisterPacketSender([](unsigned char*, uint64_t) {});
+    g_xtouch->SetPacketGap(std::chrono::microseconds(0));
+    g_delayedThreadScheduler = new DelayedExecuter();
+    g_interfaceManager = new InterfaceManager(g_xtouch);
+    g_mailbox = new Mailbox();
+
+    // Cold start, without an MA server nothing is sent or polled
+    ChannelGroupConfig config;
+    config.pageCount = PAGE_COUNT;
+    config.channelCount = CHANNEL_COUNT;
+    config.stateFile = "";
+    ChannelGroup group(config);
+
+    TestUnpinned(group);
+    TestPinnedOnPage(group);
+    TestPinnedOnOtherPage(group);
+    TestAllPinned(group);
+    TestNavigation(group);
+
+    printf("%s\n", s_passed ? "PASS" : "FAIL");
+    return s_passed ? 0 : 1;
+}
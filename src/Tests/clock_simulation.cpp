@@ -0,0 +1,102 @@
+// Steps a VirtualClock from one deadline to the next and checks that a periodic sleeper, a debounced
+// DelayedExecuter registration and a one-shot timer fire at exactly their virtual times, in order.
+#include <clock.h>
+#include <delayed.h>
+#include <trace.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+Clock *g_clock;
+DelayedExecuter *g_delayedThreadScheduler;
+Tracer *g_trace;
+
+namespace {
+    using namespace std::chrono;
+
+    struct Event {
+        std::string name;
+        int64_t at; // Virtual milliseconds since the start
+    };
+
+    std::mutex s_mutex_log;
+    std::vector<Event> s_log;
+    Clock::time_point s_start;
+
+    void Log(std::string name) {
+        std::lock_guard<std::mutex> lock(s_mutex_log);
+        s_log.push_back({ name, duration_cast<milliseconds>(Clock::now() - s_start).count() });
+    }
+
+    constexpr int TICK_INTERVAL = 70;
+    constexpr int TICK_COUNT = 20;
+    constexpr uint32_t DEBOUNCE_DELAY = 125;
+    constexpr uint32_t TIMER_DELAY = 200;
+
+    void Ticker(VirtualClock *clock) {
+        for(int i = 1; i <= TICK_COUNT; i++) {
+            clock->SleepUntil(s_start + milliseconds(i * TICK_INTERVAL));
+            Log("tick");
+        }
+        clock->Leave();
+    }
+
+    // Input arriving at fixed virtual times
+    void Script(VirtualClock *clock) {
+        auto debounce = g_delayedThreadScheduler->Register([](float value) { Log("debounce " + std::to_string((int)value)); }, DEBOUNCE_DELAY);
+        auto timer = g_delayedThreadScheduler->Register([](float) { Log("timer"); }, TIMER_DELAY);
+        g_delayedThreadScheduler->Update(timer, 1);
+
+        auto at = [clock](int ms) { clock->SleepUntil(s_start + milliseconds(ms)); };
+        at(10);  g_delayedThreadScheduler->Update(debounce, 1);
+        at(60);  g_delayedThreadScheduler->Update(debounce, 2); // Each change restarts the delay
+        at(100); g_delayedThreadScheduler->Update(debounce, 3);
+        at(300); g_delayedThreadScheduler->Update(debounce, 4);
+        at(330); g_delayedThreadScheduler->Update(debounce, 4); // Unchanged, keeps the deadline
+        at(500); g_delayedThreadScheduler->Update(debounce, 5);
+        at(560); g_delayedThreadScheduler->Cancel(debounce);
+        clock->Leave();
+    }
+}
+
+int main(int, char**) {
+    auto clock = new VirtualClock();
+    g_clock = clock;
+    s_start = clock->Now();
+    g_delayedThreadScheduler = new DelayedExecuter();
+
+    std::thread ticker(Ticker, clock);
+    std::thread script(Script, clock);
+    // The executer, the ticker and the script, before any time passes
+    while (clock->Waiting() < 3) { std::this_thread::yield(); }
+    while (clock->AdvanceToNextDeadline()) {}
+    ticker.join();
+    script.join();
+
+    std::vector<Event> expected;
+    for(int i = 1; i <= TICK_COUNT; i++) { expected.push_back({ "tick", i * TICK_INTERVAL }); }
+    expected.push_back({ "timer", TIMER_DELAY });
+    expected.push_back({ "debounce 3", 100 + DEBOUNCE_DELAY });
+    expected.push_back({ "debounce 4", 300 + DEBOUNCE_DELAY });
+    std::stable_sort(expected.begin(), expected.end(), [](const Event &a, const Event &b) { return a.at < b.at; });
+
+    bool passed = s_log.size() == expected.size();
+    for(size_t i = 0; i < s_log.size() || i < expected.size(); i++) {
+        const Event *actual = i < s_log.size() ? &s_log[i] : nullptr;
+        const Event *wanted = i < expected.size() ? &expected[i] : nullptr;
+        bool match = actual && wanted && actual->name == wanted->name && actual->at == wanted->at;
+        passed &= match;
+        if (!match) {
+            printf("#%zu expected %s at %lld ms, got %s at %lld ms\n", i,
+                wanted ? wanted->name.c_str() : "nothing", wanted ? (long long)wanted->at : 0LL,
+                actual ? actual->name.c_str() : "nothing", actual ? (long long)actual->at : 0LL);
+        }
+    }
+    printf("%s: %zu events, virtual time %lld ms\n", passed ? "PASS" : "FAIL", s_log.size(),
+        (long long)duration_cast<milliseconds>(clock->Now() - s_start).count());
+    return passed ? 0 : 1;
+}
@@ -7,9 +7,10 @@ void Channel::Disable() {
     auto address = m_address->Get();
     if (address.subAddress == UINT32_MAX) { return; } 
 
+    ObserverTransaction transaction;
     m_scribbleColour->Set(xt_colours_t::RED);
     m_scribbleBottomText->Set("None");
-    g_xtouch->SetFaderLevel(PHYSICAL_CHANNEL_ID - 1, 0);
+    if (!m_encoder[0].IsTouched()) { g_xtouch->SetFaderLevel(PHYSICAL_CHANNEL_ID - 1, 0); }
 }
 
 void Channel::UpdateEncoderFromXT(int value, bool isFader) {
@@ -21,19 +22,23 @@ void Channel::UpdateEncoderFromXT(int value, bool isFader) {
     auto &enc = GetEncoderRefFromType(IPC::PlaybackRefresh::EncoderType::x200);
     assert(enc.m_type == EncoderId::Fader);
 
+    m_faderLevel = value;
+    if (enc.IsTouched()) { m_movedWhileTouched = true; }
+
     auto address = m_address->Get();
     auto normalized_value = (value / 16380.0f) * 100.0f; // 0.0f - 100.0f
     enc.SetValue(normalized_value, true);
 
     IPC::IPCHeader header;
     header.type = IPC::PacketType::UPDATE_MA_ENCODER;
-    header.seq = 0; // TODO: Implement sequence number
+    header.seq = 0; // Stamped by MaUDPServer::Send
 
     IPC::EncoderUpdate::Data packet;
     packet.channel = address.subAddress;
     packet.page = address.mainAddress;
     packet.value = normalized_value;
     packet.encoderType = 200; // Fader
+    packet.generation = enc.WriteGeneration();
 
     auto packet_size = sizeof(IPC::IPCHeader) + sizeof(IPC::EncoderUpdate::Data);
     char *buffer = (char*)malloc(packet_size);
@@ -42,45 +47,50 @@ void Channel::UpdateEncoderFromXT(int value, bool isFader) {
     m_maServer->Send(buffer, packet_size);
     free(buffer);
 
-    m_lastPhysicalChange = std::chrono::system_clock::now();
+    m_lastPhysicalChange = Clock::now();
 }
 
 void Channel::UpdateDial(int value) {
      if (!m_maServer) {return;}
-    auto address = m_address->Get();
+    // Value is "relative" from XT (eg (-3,3)), ticks are accumulated until FlushDial
+    m_dialAccel[m_toggle ? 1 : 0].Tick(value, DialAccelerator::clock::now());
+}
+
+void Channel::FlushDial() {
     // 0 = 4xx, 1 = 3xx
-    IPC::PlaybackRefresh::EncoderType type = m_toggle ? IPC::PlaybackRefresh::EncoderType::x300 : IPC::PlaybackRefresh::EncoderType::x400;
+    float delta = m_dialAccel[0].TakePending();
+    if (delta != 0.0f) { SendDial(IPC::PlaybackRefresh::EncoderType::x400, delta); }
+    delta = m_dialAccel[1].TakePending();
+    if (delta != 0.0f) { SendDial(IPC::PlaybackRefresh::EncoderType::x300, delta); }
+}
+
+void Channel::SendDial(IPC::PlaybackRefresh::EncoderType type, float delta) {
+    if (!m_maServer) {return;}
+    auto address = m_address->Get();
     auto &enc = GetEncoderRefFromType(type);
-    if (m_toggle) {
+    if (type == IPC::PlaybackRefresh::EncoderType::x300) {
         assert(enc.m_type == EncoderId::SoundMeter);
     } else {
         assert(enc.m_type == EncoderId::Dial);
     }
     auto current_value = enc.GetValue();
 
-
-    auto func = [](int x) -> float {
-        bool negative = x < 0;
-        auto _pow = pow(abs(x), 1.2);
-        auto result = (0.665 * _pow);
-        result = negative ? -result : result;
-        return result;
-    };
-
-    auto scaled_value = current_value + func(value); // Value is "relative" from XT (eg (-3,3))
+    auto scaled_value = current_value + delta;
     auto top = fmax(scaled_value, 0.0f);
     auto bottom = fmin(top, 100.0f);
+    if (bottom == current_value) { return; } // Already at the end of the range
     enc.SetValue(bottom, true);
 
     IPC::IPCHeader header;
     header.type = IPC::PacketType::UPDATE_MA_ENCODER;
-    header.seq = 0; // TODO: Implement sequence number
+    header.seq = 0; // Stamped by MaUDPServer::Send
 
     IPC::EncoderUpdate::Data packet;
     packet.channel = address.subAddress;
     packet.page = address.mainAddress;
     packet.value = bottom;
-    packet.encoderType = m_toggle ? 300 : 400; 
+    packet.encoderType = type == IPC::PlaybackRefresh::EncoderType::x300 ? 300 : 400; 
+    packet.generation = enc.WriteGeneration();
 
     auto packet_size = sizeof(IPC::IPCHeader) + sizeof(IPC::EncoderUpdate::Data);
     char *buffer = (char*)malloc(packet_size);
@@ -89,7 +99,19 @@ void Channel::UpdateDial(int value) {
     m_maServer->Send(buffer, packet_size);
     free(buffer);
 
-    m_lastPhysicalChange = std::chrono::system_clock::now();
+    m_lastPhysicalChange = Clock::now();
+}
+
+void Channel::SetFaderTouched(bool touched) {
+    auto &enc = GetEncoderRefFromType(IPC::PlaybackRefresh::EncoderType::x200);
+    if (enc.IsTouched() == touched) { return; }
+    enc.SetTouched(touched);
+    if (touched) { m_movedWhileTouched = false; return; }
+
+    // Released, send the resting position once more. MA may have dropped or reordered
+    // writes during the move, and feedback resumes once this final write is confirmed.
+    if (m_movedWhileTouched) { UpdateEncoderFromXT(m_faderLevel, true); }
+    m_movedWhileTouched = false;
 }
 
 Encoder& Channel::GetEncoderRefFromType(IPC::PlaybackRefresh::EncoderType type) {
@@ -123,7 +145,7 @@ Encoder& Channel::GetEncoderRefFromType(IPC::PlaybackRefresh::EncoderType type)
     }
 }
 
-void Channel::UpdateEncoderFromMA(IPC::PlaybackRefresh::Data encoder, bool updateButtonLights) {
+void Channel::UpdateEncoderFromMA(IPC::PlaybackRefresh::Data encoder, LedScene &lights) {
     auto address = m_address->Get();
     ASSERT_EQ_INT(address.mainAddress, encoder.page);
     ASSERT_EQ_INT(address.subAddress, encoder.channel);
@@ -131,28 +153,36 @@ void Channel::UpdateEncoderFromMA(IPC::PlaybackRefresh::Data encoder, bool updat
 
     // 0,   1,   2
     // 4xx, 3xx, 2xx encoders
+    // Slots without an executor are sent with type None, but keep their position
+    const IPC::PlaybackRefresh::EncoderType slotTypes[3] = {
+        IPC::PlaybackRefresh::EncoderType::x400,
+        IPC::PlaybackRefresh::EncoderType::x300,
+        IPC::PlaybackRefresh::EncoderType::x200
+    };
     for(int i = 0; i < 3; i++) {
-        auto &enc = GetEncoderRefFromType(encoder.Encoders[i].type);
-        enc.SetValue(encoder.Encoders[i].value, false);   
+        auto type = encoder.Encoders[i].type;
+        if (type == IPC::PlaybackRefresh::EncoderType::None) { type = slotTypes[i]; }
+        auto &enc = GetEncoderRefFromType(type);
+        enc.SetValue(encoder.Encoders[i].value, false, encoder.Encoders[i].generation);
         enc.SetActive(encoder.Encoders[i].isActive);
 
         // Code below is for encoders 4xx and 3xx       
         if (i == 3) { continue; }
 
-        enc.SetName(encoder.Encoders[i].key_name);
+        // key_name is padded to 8 characters, not null terminated
+        std::string name(encoder.Encoders[i].key_name, strnlen(encoder.Encoders[i].key_name, sizeof(encoder.Encoders[i].key_name)));
+        enc.SetName(name);
         if (m_toggle && i == 1) // m_toggle means we're displaying the 3xx encoder
         {
-            m_scribbleBottomText->Set(encoder.Encoders[1].key_name);
+            m_scribbleBottomText->Set(name);
         }
         else if (!m_toggle && i == 0) 
         {
-            m_scribbleBottomText->Set(encoder.Encoders[0].key_name);
+            m_scribbleBottomText->Set(name);
         }
 
     }
 
-    if (!updateButtonLights) { return; }
-
     // Here we light up or turn off buttons on the X-Touch based on if a "channel"
     // has a key active for that encoder. REC, SOLO, MUTE, SELECT represents keys 4xx, 3xx, 2xx, 1xx respectively
     auto distance = FADER_1_MUTE - FADER_0_MUTE;
@@ -163,45 +193,60 @@ void Channel::UpdateEncoderFromMA(IPC::PlaybackRefresh::Data encoder, bool updat
         m_keysActive[i] = encoder.keysActive[i];
         xt_button_state_t state = encoder.keysActive[i] ? xt_button_state_t::ON : xt_button_state_t::OFF;
 
-        g_xtouch->SetSingleButton(offsets[i] + (FADER * distance), state);
+        lights.Set(offsets[i] + (FADER * distance), state);
 
     }
 }
 
 Channel::Channel(uint32_t id): PHYSICAL_CHANNEL_ID(id) {
     assert(PHYSICAL_CHANNEL_ID >= 1 && PHYSICAL_CHANNEL_ID <= PHYSICAL_CHANNEL_COUNT);
+    // Created first, the address observer below resets them
+    m_encoder = (Encoder*)(malloc(sizeof(Encoder) * 3));
+    for(int i = 0; i < 3; i++) {
+        auto channel = new (&m_encoder[i]) Encoder(static_cast<EncoderId>(i), PHYSICAL_CHANNEL_ID);
+    }
     m_scribblePad = {
         .TopText = {0},
         .BotText = {0},
         .Colour = xt_colours_t::WHITE,
         .Inverted = 1
     };
-    m_scribbleBottomText = new Observer<std::string>("", [&](std::string text) {
-        snprintf(m_scribblePad.BotText, 8, "%s", text.c_str());
-        g_xtouch->SetScribble(PHYSICAL_CHANNEL_ID - 1, m_scribblePad);
-    });
-    m_scribbleColour = new Observer<xt_colours_t>(xt_colours_t::BLACK, [&](xt_colours_t colour) {
-        m_scribblePad.Colour = colour;
-        g_xtouch->SetScribble(PHYSICAL_CHANNEL_ID - 1, m_scribblePad);
-    });
-    m_address = new Observer<Address>({1, id}, [&](Address address) {
-        if (address.subAddress == UINT32_MAX) {
-            snprintf(m_scribblePad.TopText, 8, "----");
-            m_scribbleBottomText->Set("");
-            m_scribbleColour->Set(xt_colours_t::BLACK);
-            return;
-        }
-        m_scribblePad.Colour = xt_colours_t::WHITE;
-        snprintf(m_scribblePad.TopText, 8, "%u.%u", address.mainAddress, 100 + address.subAddress);
-        g_xtouch->SetScribble(PHYSICAL_CHANNEL_ID - 1, m_scribblePad); // PHYSICAL_CHANNEL_ID is 1-indexed, scribble is 0-indexed
-    });
-    m_lastPhysicalChange = std::chrono::system_clock::from_time_t(0);
+    m_scribble = new ChannelObserver<xt_ScribblePad_t, &Channel::OnScribbleChange>(m_scribblePad, { this });
+    m_scribbleBottomText = new ChannelObserver<std::string, &Channel::OnScribbleTextChange>("", { this });
+    m_scribbleColour = new ChannelObserver<xt_colours_t, &Channel::OnScribbleColourChange>(xt_colours_t::BLACK, { this });
+    m_address = new Observer<Address, MemberCallback<Channel, Address, &Channel::OnAddressChange>>({1, id}, { this });
+    m_lastPhysicalChange = Clock::time_point();
+}
+
+void Channel::OnScribbleChange(const xt_ScribblePad_t &pad) {
+    g_xtouch->SetScribble(PHYSICAL_CHANNEL_ID - 1, pad); // PHYSICAL_CHANNEL_ID is 1-indexed, scribble is 0-indexed
+}
 
+void Channel::OnScribbleColourChange(const xt_colours_t &colour) {
+    m_scribblePad.Colour = colour;
+    m_scribble->Set(m_scribblePad);
+}
 
-    m_encoder = (Encoder*)(malloc(sizeof(Encoder) * 3));
-    for(int i = 0; i < 3; i++) {
-        auto channel = new (&m_encoder[i]) Encoder(static_cast<EncoderId>(i), PHYSICAL_CHANNEL_ID);
+void Channel::OnScribbleTextChange(const std::string &text) {
+    snprintf(m_scribblePad.BotText, 8, "%s", text.c_str());
+    m_scribble->Set(m_scribblePad);
+}
+
+void Channel::OnAddressChange(const Address &address) {
+    // Outstanding writes belong to the previous executor
+    for(int i = 0; i < 3; i++) { m_encoder[i].ResetGeneration(); }
+
+    // Top text, bottom text and colour go out as a single scribble update
+    ObserverTransaction transaction;
+    if (address.subAddress == UINT32_MAX) {
+        snprintf(m_scribblePad.TopText, 8, "----");
+        m_scribbleBottomText->Set("");
+        m_scribbleColour->Set(xt_colours_t::BLACK);
+    } else {
+        snprintf(m_scribblePad.TopText, 8, "%u.%u", address.mainAddress, 100 + address.subAddress);
+        m_scribbleColour->Set(xt_colours_t::WHITE);
     }
+    m_scribble->Set(m_scribblePad);
 }
 
 void Channel::Pin(bool state) {
@@ -223,8 +268,10 @@ void Channel::RegisterMaSend(MaUDPServer *server) {
     m_maServer = server;
 }
 
+uint32_t Encoder::s_nextGeneration = 1;
+
 Encoder::Encoder(EncoderId type, uint32_t id): m_type(type), PHYSICAL_CHANNEL_ID(id) {
-    m_lastPhysicalChange = std::chrono::system_clock::from_time_t(0);
+    m_lastPhysicalChange = Clock::time_point();
 
     // Spent a lot of time trying to figure out why there was stuttering on the dials
     // The 'stuttering' led to the dial, when being turned, would periodically 'jump' back to the previous value
@@ -233,25 +280,46 @@ Encoder::Encoder(EncoderId type, uint32_t id): m_type(type), PHYSICAL_CHANNEL_ID
     // This was confirmed by printing the update value before calling SetFader, then printing the output of GetFader({}).
     // The result was that the value was not updated, and the value was the same as the previous value.
     // Confirmed others have observed this: https://forum.malighting.com/forum/thread/9009-thread-timing-issues-when-setting-reading-fader-value/?postID=22948#post22948
-    if (type == EncoderId::Fader || type == EncoderId::Master) {
-        m_delayTime = 500;
-    } else {
-        m_delayTime = 50;
-    }
+    // Every write is tagged with a generation, and the plugin only reports it back once GetFader reflects the write,
+    // so feedback is held back for exactly as long as MA takes to apply the value.
+}
+
+uint32_t Encoder::WriteGeneration() {
+    return m_writeGeneration;
+}
+
+void Encoder::ResetGeneration() {
+    m_writeGeneration = 0;
+}
+
+void Encoder::SetTouched(bool touched) {
+    m_touched = touched;
+}
+
+bool Encoder::IsTouched() {
+    return m_touched;
 }
 
 float Encoder::GetValue() {
     return m_value;
 }
-void Encoder::SetValue(float value, bool physical) {
+void Encoder::SetValue(float value, bool physical, uint32_t generation) {
     if (!physical)
     { 
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - m_lastPhysicalChange); 
-        if (duration.count() < m_delayTime ) { return; }
+        if (m_touched) { return; } // The operator owns the value until release
+        // Generations wrap, compare by distance
+        if (m_writeGeneration != 0 && static_cast<int32_t>(generation - m_writeGeneration) < 0) {
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_lastPhysicalChange); 
+            if (duration.count() < FEEDBACK_TIMEOUT_MS) { return; }
+            // MA never confirmed the write (eg the executor was deleted), follow MA again
+        }
+        m_writeGeneration = 0;
     } 
     else 
     {
-        m_lastPhysicalChange = std::chrono::system_clock::now();
+        m_lastPhysicalChange = Clock::now();
+        m_writeGeneration = s_nextGeneration++;
+        if (s_nextGeneration == 0) { s_nextGeneration = 1; } // 0 means no write outstanding
     }
 
 
@@ -1,23 +1,25 @@
 #include <ChannelGroup.h>
-#include <set>
 #include <string.h>
 #include <delayed.h>
+#include <mailbox.h>
+#include <startup.h>
+#include <latency.h>
+#include <metrics.h>
+#include <trace.h>
 
 void ChannelGroup::PinInterfaceLayer::Resume() {
 }
+// Opaque scene, everything but the pin button and the pin state of each channel is dark
 void ChannelGroup::PinInterfaceLayer::UpdateLights() {
-    g_xtouch->ClearButtonLights();
-    g_xtouch->SetSingleButton(static_cast<xt_buttons>(xt_alias_btn::PIN), xt_button_state_t::FLASHING);
-
-     for(int i = 0; i < 8; i++) {
-        auto select_btn = static_cast<xt_buttons>(FADER_0_SELECT + i);
-        auto mute_btn = static_cast<xt_buttons>(FADER_0_MUTE + i);
+    m_lights.SetOpaque(true);
+    m_buttons.ForEachButton(ButtonActions::PIN_MODE, [this](uint32_t button) {
+        m_lights.Set(button, xt_button_state_t::FLASHING);
+    });
 
-        if (m_channels[i].IsPinned()) {
-            g_xtouch->SetSingleButton(mute_btn, xt_button_state_t::ON);
-        } else {
-            g_xtouch->SetSingleButton(select_btn, xt_button_state_t::ON);
-        }
+    for(int i = 0; i < 8; i++) {
+        bool pinned = m_channels[i].IsPinned();
+        m_lights.Set(FADER_0_MUTE + i, pinned ? xt_button_state_t::ON : xt_button_state_t::OFF);
+        m_lights.Set(FADER_0_SELECT + i, pinned ? xt_button_state_t::OFF : xt_button_state_t::ON);
     }
 }
 void ChannelGroup::PinInterfaceLayer::Pause() {}
@@ -25,18 +27,28 @@ void ChannelGroup::PinInterfaceLayer::Start() {
     UpdateLights();
 }
 void ChannelGroup::PinInterfaceLayer::Removed() { delete this; }
+void ChannelGroup::PinInterfaceLayer::DeclareRoutes(InputRoutes &routes) {
+    // Every system button is swallowed while pinning, faders keep working
+    routes.Add(PhysicalEventType::BUTTON);
+    routes.Add(PhysicalEventType::FADER_BUTTON);
+    routes.Add(PhysicalEventType::JOG);
+}
 bool ChannelGroup::PinInterfaceLayer::HandleInput(PhysicalEvent event) {
     switch(event.type)
     {
         case PhysicalEventType::BUTTON:
         {
-            if (event.data.button.Id == xt_alias_btn::PIN) 
+            if (m_buttons.IsBound(event.data.button.Id, ButtonActionType::PIN_MODE)) 
             {
                 if (event.data.button.down) { return true; } // Only handle on key release
                 g_interfaceManager->PopLayer();
             }
             return true;
         }
+        case PhysicalEventType::JOG:
+        {
+            return true; // Navigating while pinning would move the channels being picked
+        }
         case PhysicalEventType::FADER_BUTTON:
         {
             if (event.data.faderButton.down) { return true; } // Only handle on key release
@@ -65,44 +77,76 @@ bool ChannelGroup::PinInterfaceLayer::HandleInput(PhysicalEvent event) {
 
 void ChannelGroup::GroupInterfaceLayer::Resume() {
     m_group->GenerateChannelWindows(); // Regenerate the channel windows in case the user has pinned/unpinned channels
-    g_xtouch->PopLightState();
-    m_group->m_blockUpdates = false;
-}
-void ChannelGroup::GroupInterfaceLayer::Pause() {
-    m_group->m_blockUpdates = true;
-    g_xtouch->PushLightState(true);
+    m_group->PublishChannelAddresses();
 }
+void ChannelGroup::GroupInterfaceLayer::Pause() {}
 void ChannelGroup::GroupInterfaceLayer::Start() {}
 void ChannelGroup::GroupInterfaceLayer::Removed() {}
+void ChannelGroup::GroupInterfaceLayer::DeclareRoutes(InputRoutes &routes) {
+    routes.Add(PhysicalEventType::FADER);
+    routes.Add(PhysicalEventType::DIAL);
+    routes.Add(PhysicalEventType::FADER_BUTTON);
+    routes.Add(PhysicalEventType::DIAL_PRESS);
+    routes.Add(PhysicalEventType::MASTER);
+    routes.Add(PhysicalEventType::FADER_TOUCH);
+    routes.Add(PhysicalEventType::JOG);
+    m_group->m_buttons.AddRoutes(routes, ButtonActionType::SCROLL);
+    m_group->m_buttons.AddRoutes(routes, ButtonActionType::PAGE);
+    m_group->m_buttons.AddRoutes(routes, ButtonActionType::PIN_MODE);
+}
 bool ChannelGroup::GroupInterfaceLayer::HandleInput(PhysicalEvent event) {
     return cb_HandleInput(event);
 }
 
-ChannelGroup::ChannelGroup() {
+ChannelGroup::ChannelGroup(ChannelGroupConfig config) :
+    m_pageCount(config.pageCount),
+    m_channelCount(config.channelCount),
+    m_refreshScheduler(config.refresh),
+    m_input(config.input),
+    m_buttons(config.buttons)
+{
+    assert(m_pageCount >= 1 && m_pageCount <= MAX_PAGE_COUNT);
+    assert(m_channelCount >= 1 && m_channelCount <= MAX_CHANNEL_COUNT);
+
     m_channels = (Channel*)(malloc(sizeof(Channel) * PHYSICAL_CHANNEL_COUNT));
     for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
         auto channel = new (&m_channels[i]) Channel(i + 1);
     }
     m_masterFaderEncoder = new Encoder(EncoderId::Master, 0);
+    // Created before anything is shown, channels and navigation light buttons through its scene
+    m_interfaceLayer = new GroupInterfaceLayer(this);
+    m_interfaceLayer->cb_HandleInput = [this](PhysicalEvent event) { return HandlePhysicalEvent(event); };
 
-    m_page = new Observer<uint32_t>(1, [](uint32_t page) { 
-        g_xtouch->SetAssignment(page);
-    });
+    m_page = new Observer<uint32_t>(1, [this](uint32_t page) { ShowPage(page); });
     
-    GenerateChannelWindows();
-    m_playbackRefresh = std::thread(&ChannelGroup::RefreshPlaybacks, this);
-    m_playbackRefresh.detach();
+    if (!config.stateFile.empty() && m_warmState.Open(config.stateFile.c_str(), m_pageCount, m_channelCount)) {
+        RestoreWarmState();
+    } else {
+        GenerateChannelWindows();
+    }
+    PublishChannelAddresses();
 
-    m_interfaceLayer = new GroupInterfaceLayer(this);
-    m_interfaceLayer->cb_HandleInput = [this](PhysicalEvent event) { return HandlePhysicalEvent(event); };
     g_interfaceManager->PushLayer(m_interfaceLayer);
 
     // Initial light states
-    SetLight(xt_alias_btn::PAGE_INC, xt_button_state_t::ON);
-    SetLight(xt_alias_btn::EXECUTER_SCROLL_RIGHT, xt_button_state_t::ON);
+    SetLight(ButtonActions::PAGE_INC, xt_button_state_t::ON);
+    SetLight(ButtonActions::SCROLL_RIGHT, xt_button_state_t::ON);
 }
 
 bool ChannelGroup::HandlePhysicalEvent(PhysicalEvent event)
+{
+    m_refreshScheduler.NoteActivity();
+    // Faders, dials and the master are merged per frame and sent from FlushPendingInput
+    if (m_input.Absorb(event, InputCoalescer::clock::now())) { return true; }
+
+    // Anything still pending belongs to the current touch
+    bool touch_release = event.type == PhysicalEventType::FADER_TOUCH && !event.data.faderTouch.touched;
+    if (touch_release) { FlushInput(true); }
+
+    return DispatchInput(event);
+}
+
+bool ChannelGroup::DispatchInput(PhysicalEvent event)
 {
     switch(event.type) 
     {
@@ -135,20 +179,9 @@ bool ChannelGroup::HandlePhysicalEvent(PhysicalEvent event)
         }
         case PhysicalEventType::BUTTON: 
         {
-            if (ButtonUtils::AddressChangingButton(static_cast<xt_buttons>(event.data.button.Id))) 
-            {  
-                // Only handle on key release
-                if (!event.data.button.down) { HandleAddressChange(static_cast<xt_alias_btn>(event.data.button.Id)); } 
-                return true;
-            }
-            if (event.data.button.Id == xt_alias_btn::PIN) 
-            {
-                if (event.data.button.down) { return true; } // Only handle on key release
-                auto pinlayer = new PinInterfaceLayer(m_channels);
-                g_interfaceManager->PushLayer(pinlayer);
-                return true;
-            }
-            return false;
+            // Only handle on key release
+            if (!event.data.button.down) { HandleButtonAction(m_buttons.Action(event.data.button.Id)); }
+            return true;
         }
         case PhysicalEventType::MASTER: 
         {
@@ -157,7 +190,19 @@ bool ChannelGroup::HandlePhysicalEvent(PhysicalEvent event)
         }
         case PhysicalEventType::JOG: 
         {
-            return false;
+            HandleJog(event.data.jog.value);
+            return true;
+        }
+        case PhysicalEventType::FADER_TOUCH: 
+        {
+            auto column = event.data.faderTouch.Column;
+            assert(column >= 0 && column <= 8); // Ensure we're within bounds
+            if (column == 8) {
+                SetMasterTouched(event.data.faderTouch.touched);
+            } else {
+                m_channels[column].SetFaderTouched(event.data.faderTouch.touched);
+            }
+            return true;
         }
         default:
         {
@@ -167,33 +212,105 @@ bool ChannelGroup::HandlePhysicalEvent(PhysicalEvent event)
     assert(false && "Event not handled");
 }
 
-void ChannelGroup::HandleAddressChange(xt_alias_btn btn) {
-    switch (btn) {
-        case xt_alias_btn::EXECUTER_SCROLL_LEFT: 
-        case xt_alias_btn::EXECUTER_SCROLL_RIGHT: 
+void ChannelGroup::HandleButtonAction(const ButtonAction &action) {
+    switch (action.type) {
+        case ButtonActionType::SCROLL: 
         {
-            uint32_t offset = btn == xt_alias_btn::EXECUTER_SCROLL_LEFT ? -1 : 1;
-            ScrollPage(offset);
+            ScrollPage(action.value);
             return;
         }
-        case xt_alias_btn::PAGE_DEC:
-        case xt_alias_btn::PAGE_INC: 
+        case ButtonActionType::PAGE: 
         {
-            uint32_t offset = btn == xt_alias_btn::PAGE_DEC ? -1 : 1; 
-            ChangePage(offset);
+            ChangePage(action.value);
             return;
         }
-        default: { assert(false); }
+        case ButtonActionType::PIN_MODE: 
+        {
+            FlushNavigation(InputCoalescer::clock::now(), true); // Pin against the channels being navigated to
+            auto pinlayer = new PinInterfaceLayer(m_channels, m_buttons);
+            g_interfaceManager->PushLayer(pinlayer);
+            return;
+        }
+        default: { assert(false && "Button routed to the group without a group action"); }
     }
 }
 
-std::vector<Address> ChannelGroup::CurrentChannelAddress() {
-    std::vector<Address> addresses;
+// Safe to call from any thread, returns the version of the snapshot
+uint64_t ChannelGroup::CurrentChannelAddress(ChannelAddressSnapshot &snapshot) {
+    return m_addressTable.Read(snapshot);
+}
+
+// Must be called from the thread that navigates the surface, after the channel addresses change.
+// Publishing also bumps the version, which invalidates any refresh request already in flight.
+void ChannelGroup::PublishChannelAddresses() {
+    ChannelAddressSnapshot snapshot;
+    bool pinned[PHYSICAL_CHANNEL_COUNT];
     for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
-        addresses.push_back(m_channels[i].m_address->Get());
+        snapshot.channels[i] = m_channels[i].m_address->Get();
+        pinned[i] = m_channels[i].IsPinned();
     }
-    assert(addresses.size() == PHYSICAL_CHANNEL_COUNT);
-    return std::move(addresses);
+    m_addressTable.Publish(snapshot);
+    m_warmState.StoreLayout(m_page->Get(), m_channelOffset, snapshot.channels, pinned);
+}
+
+bool ChannelGroup::ValidAddress(const Address &address) {
+    return address.mainAddress >= 1 && address.mainAddress <= m_pageCount &&
+        address.subAddress >= 1 && address.subAddress <= m_channelCount;
+}
+
+// Paints the surface as the previous process left it, the first refresh corrects anything that changed since
+void ChannelGroup::RestoreWarmState() {
+    using EncoderType = IPC::PlaybackRefresh::EncoderType;
+    const WarmState::File saved = m_warmState.Get(); // Copied, applying the layout below overwrites the file
+
+    if (saved.page >= 1 && saved.page <= m_pageCount) { m_page->Set(saved.page); }
+    for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
+        auto &channel = saved.channels[i];
+        if (!channel.pinned || !ValidAddress(channel.address)) { continue; }
+        // Pins must be unique, a file written by another build or process may not hold to that
+        bool duplicate = false;
+        for(int j = 0; j < i; j++) {
+            auto pinned = m_channels[j].m_address->Get();
+            duplicate |= m_channels[j].IsPinned() && pinned.mainAddress == channel.address.mainAddress && pinned.subAddress == channel.address.subAddress;
+        }
+        if (duplicate) { continue; }
+        m_channels[i].m_address->Set(channel.address);
+        m_channels[i].Pin(true);
+    }
+    m_channelOffset = saved.channelOffset;
+    GenerateChannelWindows(); // Clamps the offset if the pins no longer allow it
+    ApplyChannelWindow();
+
+    uint32_t painted = 0;
+    for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
+        auto &channel = saved.channels[i];
+        auto address = m_channels[i].m_address->Get();
+        if (channel.address.mainAddress != address.mainAddress || channel.address.subAddress != address.subAddress) { continue; }
+
+        if (channel.state == WarmState::ChannelState::INACTIVE) {
+            DisablePhysicalChannel(i);
+            continue;
+        }
+        if (channel.state != WarmState::ChannelState::ACTIVE) { continue; }
+        if (channel.data.page != address.mainAddress || channel.data.channel != address.subAddress) { continue; }
+
+        bool valid = true;
+        for(auto &encoder : channel.data.Encoders) {
+            valid &= encoder.type == EncoderType::x200 || encoder.type == EncoderType::x300 ||
+                encoder.type == EncoderType::x400 || encoder.type == EncoderType::None;
+        }
+        if (!valid) { continue; }
+
+        UpdateEncoderFromMA(channel.data, i);
+        m_warmState.StoreChannel(i, &channel.data);
+        painted++;
+    }
+    if (saved.masterValid) {
+        m_masterFaderEncoder->SetValue(saved.master, false);
+        m_warmState.StoreMaster(saved.master);
+    }
+
+    printf("[WarmState] Restored page %u window %u, %u channels painted\n", m_page->Get(), m_channelOffset, painted);
 }
 
 void ChannelGroup::DisablePhysicalChannel(uint32_t i) {
@@ -204,108 +321,142 @@ void ChannelGroup::DisablePhysicalChannel(uint32_t i) {
 void ChannelGroup::UpdateEncoderFromMA(IPC::PlaybackRefresh::Data encoder, uint32_t physical_channel_id) {
     assert(physical_channel_id >= 0 && physical_channel_id < 8);
     auto &channel = m_channels[physical_channel_id];
-    channel.UpdateEncoderFromMA(encoder, !m_blockUpdates);
+    channel.UpdateEncoderFromMA(encoder, m_interfaceLayer->m_lights);
 }
 
+// Page and scroll presses only move the navigation target, so a burst of presses
+// is painted and fetched once, when the last of them has settled
 void ChannelGroup::ChangePage(int32_t pageOffset) {
     assert(pageOffset == -1 || pageOffset == 1);
-    m_sequence = m_sequence + 1;
-
-    uint32_t cur_page = m_page->Get();
-    if (pageOffset == -1 && cur_page > 1) { m_page->Set(cur_page - 1);;} 
-    if (pageOffset == 1 && cur_page < MAX_PAGE_COUNT) { m_page->Set(cur_page + 1); } 
-    if (m_page->Get() == cur_page) { return; }
-    GenerateChannelWindows();
-
-    // When changing page, we reset the channel subaddress
-    m_channelOffset = 0;
 
-    auto mainAddress = m_page->Get();
-    auto &window = m_channelWindows[m_channelOffset];
-    auto it = window.begin();
-    for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
-        auto &channel = m_channels[i]; if (channel.IsPinned()) { continue; }
-        assert(it != window.end());
+    auto &target = BeginNavigation(NAVIGATION_SETTLE_INTERVAL);
+    if (pageOffset == -1 && target.page > 1) { target.page--; target.offset = 0; } 
+    if (pageOffset == 1 && target.page < m_pageCount) { target.page++; target.offset = 0; } 
+    ShowPage(target.page);
+}
 
-        Address address;
-        address.mainAddress = mainAddress;
-        address.subAddress = *it;
-        m_channels[i].m_address->Set(address);
+void ChannelGroup::ShowPage(uint32_t page) {
+    if (m_pageCount <= 99) {
+        g_xtouch->SetAssignment(page);
+    } else {
+        g_xtouch->SetAssignmentWide(page);
+    }
+}
 
-        it++;
+// Each tick moves the target by a fraction of a window that grows with the turning speed.
+// Only the page number follows the wheel, the channels stay where they are until it settles.
+void ChannelGroup::HandleJog(int ticks) {
+    auto now = InputCoalescer::clock::now();
+    BeginNavigation(JOG_SETTLE_INTERVAL);
+    if (!m_jogging) {
+        m_jogging = true;
+        // The first tick of a gesture always moves, however slow the wheel is turning
+        m_jogRemainder = ticks > 0 ? 0.999f : -0.999f;
     }
 
-    RefreshPageChannelLights();
+    m_jogAccel.Tick(ticks, now);
+    m_jogRemainder += m_jogAccel.TakePending();
+    int32_t windows = static_cast<int32_t>(m_jogRemainder); // Truncates toward zero
+    m_jogRemainder -= windows;
+    if (windows == 0) { return; }
+
+    MoveNavigationTarget(windows);
+    ShowPage(m_navTarget.page);
 }
 
-void ChannelGroup::SetLight(char button, xt_button_state_t state) {
-    if (m_blockUpdates) { return; }
-    g_xtouch->SetSingleButton(button, state);
+// Starts a navigation transaction, or extends the open one, and returns its target.
+// The target is applied once no navigation input has arrived for `settle` milliseconds.
+ChannelGroup::NavigationTarget& ChannelGroup::BeginNavigation(uint32_t settle) {
+    if (!m_navPending) {
+        m_navTarget = { m_page->Get(), m_channelOffset };
+        m_navPending = true;
+    }
+    m_navDeadline = InputCoalescer::clock::now() + std::chrono::milliseconds(settle);
+    return m_navTarget;
 }
 
-void ChannelGroup::PredicateSetLight(bool predicate, char button, xt_button_state_t state) {
-    if (m_blockUpdates) { return; }
-    if (predicate) 
-    {
-        g_xtouch->SetSingleButton(button, state);
+// Moves the target through the windows of consecutive pages, as if they were one long list
+void ChannelGroup::MoveNavigationTarget(int32_t windows) {
+    auto &target = m_navTarget;
+    while (windows > 0) {
+        uint32_t end = WindowCount(target.page) - 1;
+        if (target.offset + windows <= end) { target.offset += windows; return; }
+        if (target.page == m_pageCount) { target.offset = end; return; }
+        windows -= end - target.offset + 1;
+        target.page++;
+        target.offset = 0;
     }
-    else 
-    {
-        g_xtouch->SetSingleButton(button, xt_button_state_t::OFF);
+    while (windows < 0) {
+        if (static_cast<uint32_t>(-windows) <= target.offset) { target.offset += windows; return; }
+        if (target.page == 1) { target.offset = 0; return; }
+        windows += target.offset + 1;
+        target.page--;
+        target.offset = WindowCount(target.page) - 1;
     }
+}
 
+// Applies the navigation target once its input has settled, or straight away when `force` is set
+void ChannelGroup::FlushNavigation(InputCoalescer::time_point now, bool force) {
+    if (!m_navPending || (!force && now < m_navDeadline)) { return; }
+    m_navPending = false;
+    m_jogging = false;
+    if (m_navTarget.page == m_page->Get() && m_navTarget.offset == m_channelOffset) { return; } // Ended up where it started
+
+    FlushInput(true); // Anything still pending belongs to the current addresses
+    ShowPage(m_navTarget.page); // The page shown while turning may not be the one we land on
+    m_page->Set(m_navTarget.page);
+    m_channelOffset = m_navTarget.offset;
+    GenerateChannelWindows();
+    ApplyChannelWindow();
+    RefreshPageChannelLights();
+}
+
+// Lights every button the profile binds to `action`
+void ChannelGroup::SetLight(ButtonAction action, xt_button_state_t state) {
+    auto &lights = m_interfaceLayer->m_lights;
+    m_buttons.ForEachButton(action, [&lights, state](uint32_t button) { lights.Set(button, state); });
+}
+
+void ChannelGroup::PredicateSetLight(bool predicate, ButtonAction action, xt_button_state_t state) {
+    SetLight(action, predicate ? state : xt_button_state_t::OFF);
 }
 
 void ChannelGroup::RefreshPageChannelLights() 
 {
     bool final_window = m_channelOffset == m_channelOffsetEnd;
     auto new_page = m_page->Get();
-    PredicateSetLight(!final_window, xt_alias_btn::EXECUTER_SCROLL_RIGHT, xt_button_state_t::ON);
-    PredicateSetLight(m_channelOffset > 0, xt_alias_btn::EXECUTER_SCROLL_LEFT, xt_button_state_t::ON);
-    PredicateSetLight(new_page < 99, xt_alias_btn::PAGE_INC, xt_button_state_t::ON);
-    PredicateSetLight(new_page > 1, xt_alias_btn::PAGE_DEC, xt_button_state_t::ON);
+    PredicateSetLight(!final_window, ButtonActions::SCROLL_RIGHT, xt_button_state_t::ON);
+    PredicateSetLight(m_channelOffset > 0, ButtonActions::SCROLL_LEFT, xt_button_state_t::ON);
+    PredicateSetLight(new_page < m_pageCount, ButtonActions::PAGE_INC, xt_button_state_t::ON);
+    PredicateSetLight(new_page > 1, ButtonActions::PAGE_DEC, xt_button_state_t::ON);
 
 }
 
 void ChannelGroup::ScrollPage(int32_t scrollOffset) {
     assert(scrollOffset == -1 || scrollOffset == 1);
-    assert(m_channelWindows.size() > 0 && "Channel windows not generated");
-    m_sequence = m_sequence + 1;
 
-    uint32_t original_offset = m_channelOffset;
-    if (scrollOffset == -1 && m_channelOffset > 0) { m_channelOffset--;}
-    if (scrollOffset == 1 && m_channelOffset < m_channelOffsetEnd) { m_channelOffset++; }
-    if (m_channelOffset == original_offset) { return; }
+    // Unlike the jog wheel, the scroll buttons stop at the ends of the page
+    auto &target = BeginNavigation(NAVIGATION_SETTLE_INTERVAL);
+    if (scrollOffset == -1 && target.offset > 0) { target.offset--; }
+    if (scrollOffset == 1 && target.offset < WindowCount(target.page) - 1) { target.offset++; }
+}
 
+// Assigns the current window to every unpinned physical channel. 
+// The final window might not have enough channels to fill all the physical channels,
+// the remainder are given the UINT32_MAX subaddress, which marks the channel as not valid.
+void ChannelGroup::ApplyChannelWindow() {
     auto mainAddress = m_page->Get();
-    auto &window = m_channelWindows[m_channelOffset];
-    auto &&it = window.begin();
-    bool final_window = m_channelOffset == m_channelOffsetEnd;
-    
-    int i = 0; // We need to keep track of the number of channels we've updated, since we might not update all of them if we reach the final window
-    // The final window might not have enough channels to fill all the physical channels.
-    for(; i < PHYSICAL_CHANNEL_COUNT; i++) {
+    uint32_t slot = 0;
+    ObserverTransaction transaction;
+    for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
         auto &channel = m_channels[i]; if (channel.IsPinned()) { continue; }
-        if (final_window && it == window.end()) { break; } // We've reached the final window, we need special handling
-        assert(it != window.end()); // When we're not in the final window, we should never reach the end of the list
 
         Address address;
         address.mainAddress = mainAddress;
-        address.subAddress = *it;
-        m_channels[i].m_address->Set(address);
-
-        it++;
+        address.subAddress = WindowChannel(m_channelOffset, slot++);
+        channel.m_address->Set(address);
     }
-    if (final_window && i < PHYSICAL_CHANNEL_COUNT) {
-        for(; i < PHYSICAL_CHANNEL_COUNT; i++) {
-            Address address;
-            address.mainAddress = mainAddress;
-            address.subAddress = UINT32_MAX; // This is a special value that indicates that the channel is not valid
-            m_channels[i].m_address->Set(address);
-        }
-    }
-    assert(it == window.end());
-    RefreshPageChannelLights();
+    PublishChannelAddresses();
 }
 
 void ChannelGroup::RegisterMaSend(MaUDPServer *server) {
@@ -313,54 +464,81 @@ void ChannelGroup::RegisterMaSend(MaUDPServer *server) {
     for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
         m_channels[i].RegisterMaSend(server);
     }
+    // Started here rather than in the constructor so the thread never sees the server unset
+    m_playbackRefresh = std::thread(&ChannelGroup::RefreshPlaybacks, this);
+    m_playbackRefresh.detach();
 }
 
-void ChannelGroup::GenerateChannelWindows() {
-    const auto pinned_addresses = [&]() -> std::set<Address> {
-        auto pinned = std::set<Address>();
-        uint32_t inserted = 0;
+// Number of windows needed to show `available` executors `width` at a time, at least one
+static uint32_t WindowsNeeded(uint32_t width, uint32_t available) {
+    if (width == 0 || available == 0) { return 1; }
+    return (available + width - 1) / width;
+}
 
-        for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
-            auto &channel = m_channels[i]; 
-            if (!channel.IsPinned()) { continue; }
+// Counts every pinned channel into `pinned` and returns how many of them show an executor on `page`.
+// When `onPage` is set, those executors are written to it sorted ascending.
+uint32_t ChannelGroup::CountPinned(uint32_t page, uint32_t &pinned, uint32_t *onPage) {
+    uint32_t count = 0;
+    pinned = 0;
 
-            Address address = channel.m_address->Get();
-            pinned.insert(address);
-            inserted++;
+    for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
+        auto &channel = m_channels[i]; 
+        if (!channel.IsPinned()) { continue; }
+        pinned++;
+
+        Address address = channel.m_address->Get();
+        if (address.mainAddress != page || address.subAddress < 1 || address.subAddress > m_channelCount) { continue; }
+
+        uint32_t j = count++;
+        if (onPage == nullptr) { continue; }
+        // Insertion sort, there are at most PHYSICAL_CHANNEL_COUNT entries
+        for(; j > 0 && onPage[j - 1] > address.subAddress; j--) {
+            onPage[j] = onPage[j - 1];
         }
+        assert((j == 0 || onPage[j - 1] != address.subAddress) && "Pinned channels not unique");
+        onPage[j] = address.subAddress;
+    }
+    return count;
+}
 
-        assert(pinned.size() == inserted && "Pinned channels not unique");
-        return std::move(pinned);
-    }();
+// Recomputes the window geometry for the current page. Pinned channels take a physical channel away
+// from every window, and channels pinned from the current page are skipped when resolving windows.
+void ChannelGroup::GenerateChannelWindows() {
+    uint32_t pinned;
+    m_pinnedOnPageCount = CountPinned(m_page->Get(), pinned, m_pinnedOnPage);
 
-    const uint32_t window_width = PHYSICAL_CHANNEL_COUNT - pinned_addresses.size();
+    m_windowWidth = PHYSICAL_CHANNEL_COUNT - pinned;
+    m_channelOffsetEnd = WindowsNeeded(m_windowWidth, m_channelCount - m_pinnedOnPageCount) - 1;
+    if (m_channelOffset > m_channelOffsetEnd) { m_channelOffset = m_channelOffsetEnd; }
+}
 
-    std::vector<std::vector<uint32_t>> windows;
-    std::vector<uint32_t> cur_window;
-    auto cur_page = m_page->Get();
-    for(unsigned int i = 1; i <= 90; i++) {
-        if (cur_window.size() == window_width) {
-            windows.push_back(cur_window);
-            cur_window.clear();
-        }
+// Number of windows on `page`, without changing the windows of the current page
+uint32_t ChannelGroup::WindowCount(uint32_t page) {
+    uint32_t pinned;
+    uint32_t pinned_on_page = CountPinned(page, pinned, nullptr);
+    return WindowsNeeded(PHYSICAL_CHANNEL_COUNT - pinned, m_channelCount - pinned_on_page);
+}
 
-        Address address = {cur_page, i};
-        if (pinned_addresses.find(address) != pinned_addresses.end()) { 
-            continue; 
-        }
-        cur_window.push_back(i);
+// Resolves the executor shown in `slot` of `window`, in O(pinned) time.
+// Returns UINT32_MAX when the slot is past the last executor of the page.
+uint32_t ChannelGroup::WindowChannel(uint32_t window, uint32_t slot) {
+    uint32_t index = window * m_windowWidth + slot;
+    if (index >= m_channelCount - m_pinnedOnPageCount) { return UINT32_MAX; }
+
+    // Walk the sorted pinned channels, every pinned channel at or below the
+    // candidate shifts it up by one
+    uint32_t channel = index + 1;
+    for(uint32_t i = 0; i < m_pinnedOnPageCount; i++) {
+        if (m_pinnedOnPage[i] <= channel) { channel++; }
     }
-    if (cur_window.size() > 0) { windows.push_back(cur_window); }
-    m_channelWindows = std::move(windows);
-    m_channelOffsetEnd = m_channelWindows.size() - 1;
-    if (m_channelOffset > m_channelOffsetEnd) { m_channelOffset = m_channelOffsetEnd; }
+    return channel;
 }
 
 void ChannelGroup::HandleFaderButton(ButtonUtils::ButtonInfo info, bool down) {
     IPC::IPCHeader header;
     IPC::ButtonEvent::ExecutorButton buttonEvent;
     header.type = IPC::PacketType::PRESS_MA_PLAYBACK_KEY;
-    header.seq = 0; // TODO: Implement sequence number
+    header.seq = 0; // Stamped by MaUDPServer::Send
 
     auto page = m_channels[info.channel].m_address->Get();
 
@@ -381,72 +559,146 @@ void ChannelGroup::HandleButtonPress(char button, bool down) {
 }
 
 void ChannelGroup::RefreshPlaybacks() {
-    // Allow board to fully engage before sending requests
-    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    Tracer::NameThread("MA refresh");
+    // Polling starts as soon as the plugin answers, the X-Touch probe is waited for in parallel
+    while (!m_maServer->Handshake(std::chrono::milliseconds(HELLO_RETRY_INTERVAL))) {}
+    g_startup->Mark(StartupTimer::PLUGIN_READY);
 
     while (true) {
         RefreshPlaybacksImpl();
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(25));
+        m_refreshScheduler.Wait();
     }
 }
 
 bool ChannelGroup::RefreshPlaybacksImpl() {
     using namespace std::chrono;
+    TraceSpan span("ChannelGroup::RefreshPlaybacksImpl");
 
     if (!m_maServer) {return true;}
 
+    // The snapshot version changes whenever the surface is navigated, a response for an older generation is stale
+    ChannelAddressSnapshot channels;
+    uint64_t generation = CurrentChannelAddress(channels);
     IPC::IPCHeader header;
     header.type = IPC::PacketType::REQ_ENCODERS;
-    header.seq = m_sequence;
+    header.seq = 0; // Stamped by MaUDPServer::Send
     IPC::PlaybackRefresh::Request request;
-    auto channels = CurrentChannelAddress();
     for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
-        request.EncoderRequest[i].channel = channels[i].subAddress;
-        request.EncoderRequest[i].page = channels[i].mainAddress;
+        request.EncoderRequest[i].channel = channels.channels[i].subAddress;
+        request.EncoderRequest[i].page = channels.channels[i].mainAddress;
     }
 
     auto packet_size = sizeof(IPC::IPCHeader) + sizeof(IPC::PlaybackRefresh::Request);
-    char *buffer = (char*)malloc(4096);
+    char buffer[4096];
     memcpy(buffer, &header, sizeof(IPC::IPCHeader));
     memcpy(buffer + sizeof(IPC::IPCHeader), &request, sizeof(IPC::PlaybackRefresh::Request));
-    m_maServer->Send(buffer, packet_size);
+    uint32_t request_seq;
+    m_maServer->Send(buffer, packet_size, &request_seq);
 
-    if (m_maServer->Read(buffer, 4096) < 0) {
-        // assert(false && "Failed to read from MA server");
-        printf("Failed to read from MA server\n");
+    // ----------------- Past this line we reuse the buffer -----------------
+    IPC::IPCHeader *resp_header = (IPC::IPCHeader*)(buffer);
+    ssize_t received;
+    Clock::time_point arrived;
+    while (true) {
+        received = m_maServer->Read(buffer, sizeof(buffer), &arrived);
+        if (received < 0) {
+            // assert(false && "Failed to read from MA server");
+            printf("Failed to read from MA server\n");
+            g_metrics->Add(Metric::MA_TIMEOUTS);
+            if (g_trace) { g_trace->Instant("MA timeout"); }
+            m_refreshScheduler.NoteResult(false, false);
+            return false;
+        }
+        // Responses to earlier requests that timed out can still arrive, skip past them
+        if (resp_header->type != IPC::PacketType::RESP_ENCODERS_META || resp_header->seq >= request_seq) { break; }
+        g_metrics->Add(Metric::MA_SEQ_MISMATCHES);
+    }
+
+    if (resp_header->type != IPC::PacketType::RESP_ENCODERS_META || resp_header->seq != request_seq) {
+        g_metrics->Add(Metric::MA_SEQ_MISMATCHES);
+        m_refreshScheduler.NoteResult(false, false);
         return false;
     }
 
-    // ----------------- Past this line we reuse the buffer -----------------
+    // Compare everything past the header against the previous response to decide how fast to poll next
+    bool changed = received != m_lastResponseSize ||
+        memcmp(buffer + sizeof(IPC::IPCHeader), m_lastResponse + sizeof(IPC::IPCHeader), received - sizeof(IPC::IPCHeader)) != 0;
+    memcpy(m_lastResponse, buffer, received);
+    m_lastResponseSize = received;
+
+    if (generation != m_addressTable.Version()) {
+        m_refreshScheduler.NoteResult(true, true); // Surface was navigated while the request was in flight
+    } else {
+        m_refreshScheduler.NoteResult(true, changed);
+    }
+
+    // The controller thread owns the channels, it applies the response and re-checks the generation
+    if (!g_mailbox->Post(CommandType::MA_RESPONSE, buffer, received, generation, arrived)) {
+        printf("Mailbox full, dropping MA response\n");
+        g_metrics->Add(Metric::MA_RESPONSES_DROPPED);
+        return false;
+    }
+    return true;
+}
+
+void ChannelGroup::FlushPendingInput() {
+    FlushInput(false);
+    FlushNavigation(InputCoalescer::clock::now(), false);
+}
+
+void ChannelGroup::FlushInput(bool force) {
+    // The coalescer hands every event the origin of its oldest input, put back whatever we were handling after
+    auto origin = LatencyTracer::Origin();
+    m_input.Flush(InputCoalescer::clock::now(), [this](const PhysicalEvent &event) { DispatchInput(event); }, force);
+    for(int i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
+        m_channels[i].FlushDial();
+    }
+    LatencyTracer::SetOrigin(origin);
+}
+
+InputCoalescer::time_point ChannelGroup::InputDeadline() {
+    auto deadline = m_input.Deadline();
+    if (m_navPending && m_navDeadline < deadline) { deadline = m_navDeadline; }
+    return deadline;
+}
+
+void ChannelGroup::ReportInput(FILE *out) {
+    m_input.Report(out);
+}
+
+// Runs on the controller thread
+void ChannelGroup::ApplyRefresh(char *buffer, uint32_t size, uint64_t generation) {
+    TraceSpan span("ChannelGroup::ApplyRefresh");
+    assert(size >= sizeof(IPC::IPCHeader) + sizeof(IPC::PlaybackRefresh::ChannelMetadata));
     uint32_t offset = sizeof(IPC::IPCHeader);
-    IPC::IPCHeader *resp_header = (IPC::IPCHeader*)(buffer);
     IPC::PlaybackRefresh::ChannelMetadata *resp_metadata = (IPC::PlaybackRefresh::ChannelMetadata*)(buffer + offset);
     offset += sizeof(IPC::PlaybackRefresh::ChannelMetadata);
     IPC::PlaybackRefresh::Data *data = (IPC::PlaybackRefresh::Data*)(buffer + offset);
 
-    if (resp_header->type != IPC::PacketType::RESP_ENCODERS_META) {
-        return false;
-    }
+    // Send input still waiting in the coalescer first, its write generation then holds back
+    // feedback that predates it instead of pulling the fader back to an older position
+    FlushInput(true);
 
-    m_masterFaderEncoder->SetValue(resp_metadata->master, false);
+    m_masterFaderEncoder->SetValue(resp_metadata->master, false, resp_metadata->masterGeneration);
+    m_warmState.StoreMaster(resp_metadata->master);
 
-    if (resp_header->seq != m_sequence) {
-        // printf("Sequence number mismatch - dropping\n");
-        return false;
+    if (generation != m_addressTable.Version()) {
+        g_metrics->Add(Metric::MA_STALE_RESPONSES);
+        return;
     }
 
     uint32_t data_iter = 0;
     for(int i = 0; i < 8; i++) {
         if(!resp_metadata->channelActive[i]) {
             DisablePhysicalChannel(i);
+            m_warmState.StoreChannel(i, nullptr);
             continue;
         }
 
+        m_warmState.StoreChannel(i, &data[data_iter]);
         UpdateEncoderFromMA(data[data_iter++], i);    
     }
-    free(buffer);
-    return true;
+    g_startup->Mark(StartupTimer::FIRST_REFRESH);
 }
 
 void ChannelGroup::HandleUpdate(UpdateType type, char button, int value) {
@@ -471,7 +723,6 @@ void ChannelGroup::HandleUpdate(UpdateType type, char button, int value) {
         }
         default: { assert(false); }
     }
-    m_sequence = m_sequence + 1;
 }
 
 void ChannelGroup::UpdateEncoderFromXT(uint32_t physical_channel_id, int value, bool isFader) {
@@ -481,20 +732,33 @@ void ChannelGroup::UpdateEncoderFromXT(uint32_t physical_channel_id, int value,
 
 void ChannelGroup::UpdateMasterEncoder(int value) {
     if (!m_maServer) {return;}
+    m_masterLevel = value;
+    if (m_masterFaderEncoder->IsTouched()) { m_masterMovedWhileTouched = true; }
     auto normalized_value = (value / 16380.0f) * 100.0f; // 0.0f - 100.0f
     m_masterFaderEncoder->SetValue(normalized_value, true);
 
     IPC::IPCHeader header;
     header.type = IPC::PacketType::UPDATE_MA_MASTER;
-    header.seq = 0; // TODO: Implement sequence number
+    header.seq = 0; // Stamped by MaUDPServer::Send
     IPC::EncoderUpdate::MasterData packet;
     packet.value = normalized_value;
+    packet.generation = m_masterFaderEncoder->WriteGeneration();
 
-    auto packet_size = sizeof(IPC::IPCHeader) + sizeof(IPC::EncoderUpdate::Data);
+    auto packet_size = sizeof(IPC::IPCHeader) + sizeof(IPC::EncoderUpdate::MasterData);
     char *buffer = (char*)malloc(packet_size);
     memcpy(buffer, &header, sizeof(IPC::IPCHeader));
-    memcpy(buffer + sizeof(IPC::IPCHeader), &packet, sizeof(IPC::EncoderUpdate::Data));
+    memcpy(buffer + sizeof(IPC::IPCHeader), &packet, sizeof(IPC::EncoderUpdate::MasterData));
     m_maServer->Send(buffer, packet_size);
     free(buffer);
 }
 
+void ChannelGroup::SetMasterTouched(bool touched) {
+    if (m_masterFaderEncoder->IsTouched() == touched) { return; }
+    m_masterFaderEncoder->SetTouched(touched);
+    if (touched) { m_masterMovedWhileTouched = false; return; }
+
+    // Released, reconcile once with MA, see Channel::SetFaderTouched
+    if (m_masterMovedWhileTouched) { UpdateMasterEncoder(m_masterLevel); }
+    m_masterMovedWhileTouched = false;
+}
+
@@ -7,70 +7,65 @@
 #include <string.h>
 #include <guards.h>
 #include <cmath>
+#include <stdlib.h>
+#include <startup.h>
+#include <latency.h>
+#include <metrics.h>
+#include <trace.h>
+#include <signal.h>
 
+// Reads a positive integer limit from the environment, falling back to `fallback` when unset or invalid
+static uint32_t EnvLimit(const char *name, uint32_t fallback, uint32_t max) {
+    const char *value = getenv(name);
+    if (value == nullptr) { return fallback; }
+
+    char *end;
+    unsigned long parsed = strtoul(value, &end, 10);
+    if (end == value || *end != '\0' || parsed < 1 || parsed > max) {
+        printf("Ignoring %s=%s, expected 1 to %u\n", name, value, max);
+        return fallback;
+    }
+    return parsed;
+}
+
+// Expands a default path holding the X-Touch port, so controllers for different surfaces keep their own files
+static std::string InstancePath(const char *format) {
+    char path[256];
+    snprintf(path, sizeof(path), format, (unsigned int)xt_port);
+    return path;
+}
+
+// Sends the system keys bound in the button profile to MA
 class ControllerInterfaceLayer : public InterfaceLayer {
     MaUDPServer *ma_server;
+    const ButtonProfile m_buttons;
 public:
-    ControllerInterfaceLayer(MaUDPServer *server) : ma_server(server) {}
+    ControllerInterfaceLayer(MaUDPServer *server, const ButtonProfile &buttons) : ma_server(server), m_buttons(buttons) {}
     void Resume() override {}
     void Pause() override {}
     void Start() override {}
     void Removed() override {
         assert(false); // Should never be removed
     }
+    void DeclareRoutes(InputRoutes &routes) override {
+        m_buttons.AddRoutes(routes, ButtonActionType::MA_KEY);
+    }
     bool HandleInput(PhysicalEvent event) override {
-        // TODO: Fix this mess, for sure.
-        if (event.type != PhysicalEventType::BUTTON) { return false; }
-        if (
-            event.data.button.Id != xt_alias_btn::CLEAR &&
-            event.data.button.Id != xt_alias_btn::STORE &&
-            event.data.button.Id != xt_alias_btn::UPDATE &&
-            event.data.button.Id != xt_alias_btn::ASSIGN &&
-            event.data.button.Id != xt_alias_btn::MOVE &&
-            event.data.button.Id != xt_alias_btn::OOPS &&
-            event.data.button.Id != xt_alias_btn::EDIT &&
-            event.data.button.Id != xt_alias_btn::ESC &&
-            event.data.button.Id != xt_alias_btn::DELETE
-        ) { return false; }
+        assert(event.type == PhysicalEventType::BUTTON); // Only the buttons declared above are routed here
+        auto &action = m_buttons.Action(event.data.button.Id);
+        assert(action.type == ButtonActionType::MA_KEY);
 
         bool down = event.data.button.down;
-        if (down) {
-            g_xtouch->SetSingleButton(event.data.button.Id, xt_button_state_t::ON);
-        } else {
-            g_xtouch->SetSingleButton(event.data.button.Id, xt_button_state_t::OFF);
-        }
-        if (event.data.button.Id == xt_alias_btn::CLEAR) {
-            ma_server->SendSystemButton(IPC::ButtonEvent::KeyType::CLEAR, event.data.button.down);
-        }
-        if (event.data.button.Id == xt_alias_btn::STORE) {
-            ma_server->SendSystemButton(IPC::ButtonEvent::KeyType::STORE, event.data.button.down);
-        }
-        if (event.data.button.Id == xt_alias_btn::UPDATE) {
-            ma_server->SendSystemButton(IPC::ButtonEvent::KeyType::UPDATE, event.data.button.down);
-        }
-        if (event.data.button.Id == xt_alias_btn::ASSIGN) {
-            ma_server->SendSystemButton(IPC::ButtonEvent::KeyType::ASSIGN, event.data.button.down);
-        }
-        if (event.data.button.Id == xt_alias_btn::MOVE) {
-            ma_server->SendSystemButton(IPC::ButtonEvent::KeyType::MOVE, event.data.button.down);
-        }
-        if (event.data.button.Id == xt_alias_btn::OOPS) {
-            ma_server->SendSystemButton(IPC::ButtonEvent::KeyType::OOPS, event.data.button.down);
-        }
-        if (event.data.button.Id == xt_alias_btn::EDIT) {
-            ma_server->SendSystemButton(IPC::ButtonEvent::KeyType::EDIT, event.data.button.down);
-        }
-        if (event.data.button.Id == xt_alias_btn::ESC) {
-            ma_server->SendSystemButton(IPC::ButtonEvent::KeyType::ESC, event.data.button.down);
-        }
-        if (event.data.button.Id == xt_alias_btn::DELETE) {
-            ma_server->SendSystemButton(IPC::ButtonEvent::KeyType::DELETE, event.data.button.down);
-        }
-
+        m_lights.Set(event.data.button.Id, down ? xt_button_state_t::ON : xt_button_state_t::OFF);
+        ma_server->SendSystemButton(static_cast<IPC::ButtonEvent::KeyType>(action.value), down);
         return true;
     }
 };
 
+bool operator==(const Address& a, const Address& b) {
+    return a.mainAddress == b.mainAddress && a.subAddress == b.subAddress;
+}
+
 bool operator<(const Address& a, const Address& b) {
     if (a.mainAddress == b.mainAddress && a.subAddress == b.subAddress) { return false; }
 
@@ -83,31 +78,145 @@ bool operator<(const Address& a, const Address& b) {
     }
 }
 
+static std::atomic<bool> s_latencyDumpRequested{false};
+static std::atomic<bool> s_traceWriteRequested{false};
+
 XTouchController::XTouchController() {
+    if (getenv("XCTL_LATENCY_TRACE") != nullptr) {
+        g_latency = new LatencyTracer();
+        signal(SIGUSR1, [](int) { s_latencyDumpRequested = true; }); // Dumped by the watchdog, not in the handler
+        printf("[Latency] Tracing, send SIGUSR1 to dump\n");
+    }
+    m_traceFile = getenv("XCTL_TRACE_FILE");
+    if (m_traceFile != nullptr) {
+        g_trace = new Tracer();
+        signal(SIGUSR2, [](int) { s_traceWriteRequested = true; }); // Written by the watchdog, not in the handler
+        printf("[Trace] Tracing, send SIGUSR2 to write %s\n", m_traceFile);
+    }
+    const char *metrics_socket = getenv("XCTL_METRICS_SOCKET");
+    std::string metrics_path = metrics_socket != nullptr ? metrics_socket : InstancePath(DEFAULT_METRICS_SOCKET);
+    if (!metrics_path.empty()) { g_metrics->Serve(metrics_path.c_str()); }
     SpawnServer(SERVER_XT);
     assert(g_xtouch != nullptr && "XTouch instance not created");
     assert(g_delayedThreadScheduler != nullptr && "XTouch instance not created");
+    assert(g_mailbox != nullptr && "Mailbox not created");
 
     g_xtouch->RegisterPacketSender([&](unsigned char *buffer, unsigned int len) 
     {
         assert(xt_server != nullptr && "Server not created");
         xt_server->Send(buffer, len);
+        m_xtPacketsSent++;
     });
+    g_xtouch->RegisterConnectCallback([] { g_startup->Mark(StartupTimer::XTOUCH_CONNECTED); });
+    g_startup->Mark(StartupTimer::SERVERS_BOUND);
 
-    m_watchDog = std::thread(&XTouchController::WatchDog, this);
-    m_watchDog.detach();
+    ChannelGroupConfig config;
+    const char *profile = getenv("XCTL_BUTTON_PROFILE");
+    if (profile != nullptr && config.buttons.Load(profile)) {
+        printf("[Profile] Loaded button layout from %s\n", profile);
+    }
 
     // Needs to be pushed before the ChannelGroup is created
-    g_interfaceManager->PushLayer(new ControllerInterfaceLayer(&ma_server));
+    g_interfaceManager->PushLayer(new ControllerInterfaceLayer(&ma_server, config.buttons));
 
-    m_group = new ChannelGroup();
+    config.pageCount = EnvLimit("XCTL_PAGE_COUNT", DEFAULT_PAGE_COUNT, MAX_PAGE_COUNT);
+    config.channelCount = EnvLimit("XCTL_CHANNEL_COUNT", DEFAULT_CHANNEL_COUNT, MAX_CHANNEL_COUNT);
+    const char *state_file = getenv("XCTL_STATE_FILE");
+    config.stateFile = state_file != nullptr ? state_file : InstancePath(DEFAULT_STATE_FILE);
+    m_group = new ChannelGroup(config);
     m_group->RegisterMaSend(&ma_server);
+
+    // Started last, it reads m_group
+    m_watchDog = std::thread(&XTouchController::WatchDog, this);
+    m_watchDog.detach();
+    g_startup->Mark(StartupTimer::GROUP_READY);
+}
+
+// The calling thread becomes the only thread touching XTouch, ChannelGroup and InterfaceManager.
+// Every other thread posts to g_mailbox, and all surface changes made while handling a batch
+// of commands are sent to the X-Touch together by the Flush at the end of the iteration.
+void XTouchController::Run() {
+    using namespace std::chrono;
+    Tracer::NameThread("Controller");
+    auto next_meter = Clock::now();
+    auto utilisation_start = next_meter;
+    Clock::duration busy(0);
+
+    while(true) {
+        auto woken = Clock::now();
+        g_metrics->Set(Metric::MAILBOX_DEPTH, g_mailbox->Depth());
+        for(uint32_t i = 0; i < MAILBOX_BATCH_SIZE; i++) {
+            if (!g_mailbox->Consume([this](Command &command) { Dispatch(command); })) { break; }
+        }
+
+        auto now = Clock::now();
+        if (now >= next_meter) {
+            TraceSpan span("Meters");
+            g_xtouch->SendAllMeters();
+            next_meter += milliseconds(METER_REFRESH_INTERVAL);
+            if (next_meter < now) { next_meter = now + milliseconds(METER_REFRESH_INTERVAL); } // Fell behind, don't burst
+        }
+
+        m_group->FlushPendingInput();
+        g_interfaceManager->FlushLights();
+        auto packets_before = m_xtPacketsSent;
+        {
+            TraceSpan span("XTouch::Flush");
+            g_xtouch->Flush();
+        }
+        if (m_feedbackOrigin != Clock::time_point()) {
+            if (m_xtPacketsSent != packets_before) { g_latency->Record(LatencyStage::MA_XT_SEND, m_feedbackOrigin); }
+            m_feedbackOrigin = Clock::time_point();
+        }
+
+        auto idle = Clock::now();
+        busy += idle - woken;
+        if (idle - utilisation_start >= seconds(1)) {
+            g_metrics->Set(Metric::LOOP_UTILISATION, busy * 1000 / (idle - utilisation_start));
+            utilisation_start = idle;
+            busy = Clock::duration(0);
+        }
+        g_mailbox->Wait(std::min(next_meter, m_group->InputDeadline()));
+    }
+}
+
+void XTouchController::Dispatch(Command &command) {
+    if (g_latency) { LatencyTracer::SetOrigin(command.origin); }
+    switch (command.type) {
+        case CommandType::XT_PACKET: {
+            g_xtouch->HandlePacket((unsigned char*)command.data, command.size);
+            break;
+        }
+        case CommandType::MA_RESPONSE: {
+            if (g_latency) {
+                g_latency->Mark(LatencyStage::MA_APPLY);
+                if (m_feedbackOrigin == Clock::time_point()) { m_feedbackOrigin = command.origin; }
+            }
+            m_group->ApplyRefresh(command.data, command.size, command.version);
+            break;
+        }
+        default: {
+            assert(false && "Unknown command");
+        }
+    }
+    LatencyTracer::ClearOrigin();
 }
 
 void XTouchController::WatchDog() {
+    using namespace std::chrono;
+    auto last_report = Clock::now();
+
     while(true) {
         if (!xt_server->Alive()) { assert(false); SpawnServer(SERVER_XT); }
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        g_clock->SleepFor(std::chrono::milliseconds(50));
+
+        if (Clock::now() - last_report >= seconds(RTT_REPORT_INTERVAL)) {
+            ma_server.ReportLatency(stdout);
+            m_group->ReportInput(stdout);
+            last_report = Clock::now();
+        }
+        if (s_latencyDumpRequested.exchange(false)) { g_latency->Dump(stdout); }
+        if (s_traceWriteRequested.exchange(false)) { g_trace->Write(m_traceFile); }
     }
 }
 
@@ -117,7 +226,11 @@ void XTouchController::SpawnServer(SpawnType type) {
             if(xt_server != nullptr) { delete xt_server; }
             xt_server = new TCPServer(xt_port, [&] (unsigned char* buffer, uint64_t len)  
                 {
-                    g_xtouch->HandlePacket(buffer, len);
+                    if (!g_mailbox->Post(CommandType::XT_PACKET, buffer, len, 0, LatencyTracer::Origin())) {
+                        printf("Mailbox full, dropping X-Touch packet\n");
+                        g_metrics->Add(Metric::XT_PACKETS_DROPPED);
+                        if (g_trace) { g_trace->Instant("Mailbox full"); }
+                    }
                 }
             );
             break;
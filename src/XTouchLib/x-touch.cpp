@@ -39,6 +39,10 @@ SOFTWARE.
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <clock.h>
+#include <latency.h>
+#include <metrics.h>
+#include <trace.h>
 
 unsigned char probe[] =         { 0xf0, 0x00, 0x20, 0x32, 0x58, 0x54, 0x00, 0xf7 };
 unsigned char proberesponse[] = { 0xf0, 0x00, 0x20, 0x32, 0x58, 0x54, 0x01, 0xf7 };
@@ -62,6 +66,15 @@ XTouch::XTouch() {
     for(i=0;i<9;i++) {
         mFaderLevels[i]=0;
     }
+    for(i=0;i<8;i++) {
+        mDialValues[i]=0;
+    }
+    memset(m_dirty,0,sizeof(m_dirty));
+    memset(m_faderDirty,0,sizeof(m_faderDirty));
+    memset(m_dialDirty,0,sizeof(m_dialDirty));
+    memset(m_scribbleDirty,0,sizeof(m_scribbleDirty));
+    m_allButtonsDirty=false;
+    m_segmentsDirty=false;
     memset(mScribblePads,0,sizeof(mScribblePads));
     for(i=0;i<8;i++) {
         mScribblePads[i].Colour=WHITE;
@@ -74,8 +87,6 @@ XTouch::XTouch() {
     m_faderCallBack = nullptr;
 
     mFullRefreshNeeded=0;
-
-    m_soundMeterRefresh = std::thread(&XTouch::SendAllMetersLoop, this);
 }
 
 XTouch::~XTouch() {
@@ -106,14 +117,19 @@ void XTouch::RegisterPacketSender(PacketCallback handler) {
     m_packetCallBack = handler;
 }
 
+void XTouch::RegisterConnectCallback(std::function<void()> handler) {
+    m_connectCallBack = handler;
+}
+
 // This moves a physical fader to the level provided (0 to 16384)
 // 12800 is the 0db mark
 // channel is in the range 0 to 8 (8=the 'main' fader)
 void XTouch::SetFaderLevel(int channel, int level)
 {
     if ((channel<0)||(channel>8)||(level<0)||(level>40960)) return;
+    if (mFaderLevels[channel]==(unsigned int)level) return;
     mFaderLevels[channel]=level;
-    SendSingleFader(channel);
+    m_faderDirty[channel]=true;
 }
 
 // Sets the level sent to the meters.
@@ -137,13 +153,6 @@ void XTouch::SendAllMeters()
     SendPacket(sendbuf,9);
 }
 
-void XTouch::SendAllMetersLoop() {
-    while(true) {
-        SendAllMeters();
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-}
-
 // Places a single mark around the dial to indicate pan position
 // Channel = 0 to 7
 // position = -6 for left pan, to +6 for right pan
@@ -151,7 +160,7 @@ void XTouch::SetDialPan(int channel, int position)
 {
     if ((position<-6)||(position>6)) return;
     int v = 1<<(position+6);
-    SendSingleDial(channel, v);
+    SetDial(channel, v);
 }
 
 // Places a growing bar graph around the dial to indicate level
@@ -165,7 +174,15 @@ void XTouch::SetDialLevel(int channel, int level)
     for(i=0;i<level;i++) {
         v+=1<<i;
     }
-    SendSingleDial(channel, v);
+    SetDial(channel, v);
+}
+
+void XTouch::SetDial(int channel, int value)
+{
+    if ((channel<0)||(channel>7)) return;
+    if (mDialValues[channel]==value) return;
+    mDialValues[channel]=value;
+    m_dialDirty[channel]=true;
 }
 
 // Displays the integer provided in the 'assignment' display
@@ -173,7 +190,16 @@ void XTouch::SetDialLevel(int channel, int level)
 void XTouch::SetAssignment(int v) {
     if ((v<-9)||(v>99)) return;
     DisplayNumber(0, 2, v);
-    SendSegments();
+    m_segmentsDirty=true;
+}
+
+// Displays the integer provided across the 'assignment' and 'bars' displays,
+// for values too wide for the assignment display alone
+// range = -9999 to 99999
+void XTouch::SetAssignmentWide(int v) {
+    if ((v<-9999)||(v>99999)) return;
+    DisplayNumber(0, 5, v);
+    m_segmentsDirty=true;
 }
 
 // Displays values passed into Hours, Minutes, Seconds, Frames
@@ -182,7 +208,7 @@ void XTouch::SetHMSF(int h, int m, int s, int f) {
     DisplayNumber(5, 2, m);
     DisplayNumber(7, 2, s);
     DisplayNumber(9, 3, f);
-    SendSegments();
+    m_segmentsDirty=true;
 }
 
 // Displays the integer provided in the 'frames' display
@@ -190,7 +216,7 @@ void XTouch::SetHMSF(int h, int m, int s, int f) {
 void XTouch::SetFrames(int v) {
     if ((v<-99)||(v>999)) return;
     DisplayNumber(9, 3, v);
-    SendSegments();
+    m_segmentsDirty=true;
 }
 
 // Displays a time provided in a tm structure into HMS
@@ -199,7 +225,7 @@ void XTouch::SetTime(struct tm* t) {
     DisplayNumber(2, 3, t->tm_hour,0);
     DisplayNumber(5, 2, t->tm_min,1);
     DisplayNumber(7, 2, t->tm_sec,1);
-    SendSegments();
+    m_segmentsDirty=true;
 }
 
 // Sets the state of a button light (OFF, FLASHING, ON)
@@ -228,13 +254,78 @@ void XTouch::SetSingleButton(unsigned char n, xt_button_state_t v) {
     if ((n>115)||(v>2)) return;
     if (mButtonLEDStates[n]==v) return;
     mButtonLEDStates[n]=v;
-    SendSingleButton(n);
+    m_dirty[n]=true;
+}
+
+// Compares every byte that is sent, including whatever follows the terminator
+bool operator==(const xt_ScribblePad_t& a, const xt_ScribblePad_t& b) {
+    return memcmp(a.TopText, b.TopText, sizeof(a.TopText)) == 0
+        && memcmp(a.BotText, b.BotText, sizeof(a.BotText)) == 0
+        && a.Colour == b.Colour
+        && a.Inverted == b.Inverted;
 }
 
 void XTouch::SetScribble(int channel, xt_ScribblePad_t info) {
     if ((channel<0)||(channel>7)) return;
     mScribblePads[channel]=info;
-    SendScribble(channel);
+    m_scribbleDirty[channel]=true;
+}
+
+// Sends every change made since the last Flush. Set* calls only update the cached state,
+// so several changes to the same control within one controller loop iteration cost a single packet.
+void XTouch::Flush()
+{
+    unsigned char sendbuf[233];
+    int i, n;
+
+    if (m_allButtonsDirty) {
+        SendAllButtons();
+        m_allButtonsDirty=false;
+        memset(m_dirty,0,sizeof(m_dirty));
+    }
+    // Running status, one note on message carrying every changed button
+    n=1;
+    sendbuf[0]=0x90;
+    for(i=0;i<116;i++) {
+        if (!m_dirty[i]) continue;
+        sendbuf[n++]=i;
+        sendbuf[n++]=mButtonLEDStates[i];
+        m_dirty[i]=false;
+    }
+    if (n>1) SendPacket(sendbuf,n);
+
+    n=0;
+    for(i=0;i<9;i++) {
+        if (!m_faderDirty[i]) continue;
+        sendbuf[n++]=0xe0+i;
+        sendbuf[n++]=mFaderLevels[i]&0x7f;
+        sendbuf[n++]=(mFaderLevels[i]>>7)&0x7f;
+        m_faderDirty[i]=false;
+    }
+    if (n>0) SendPacket(sendbuf,n);
+
+    n=1;
+    sendbuf[0]=0xb0;
+    for(i=0;i<8;i++) {
+        if (!m_dialDirty[i]) continue;
+        sendbuf[n++]=0x30+i;
+        sendbuf[n++]=mDialValues[i]&0x7F;
+        sendbuf[n++]=0x38+i;
+        sendbuf[n++]=(mDialValues[i]>>7)&0x7F;
+        m_dialDirty[i]=false;
+    }
+    if (n>1) SendPacket(sendbuf,n);
+
+    for(i=0;i<8;i++) {
+        if (!m_scribbleDirty[i]) continue;
+        SendScribble(i);
+        m_scribbleDirty[i]=false;
+    }
+
+    if (m_segmentsDirty) {
+        SendSegments();
+        m_segmentsDirty=false;
+    }
 }
 
 // ----------------------------------------------------------------------------------------------
@@ -271,17 +362,9 @@ void XTouch::DisplayNumber(unsigned char start, int len, int v, int zeros)
     int i;
     memset(display,0,13);
     if (zeros==0) {
-        if (len==2) {
-            snprintf(display,12,"%2d",v);
-        } else {
-            snprintf(display,12,"%3d",v);        
-        }
+        snprintf(display,12,"%*d",len,v);
     } else {
-        if (len==2) {
-            snprintf(display,12,"%02d",v);
-        } else {
-            snprintf(display,12,"%03d",v);        
-        }        
+        snprintf(display,12,"%0*d",len,v);
     }
     for(i=0;i<len;i++) {
         SetSegments(start+i,SegmentBitmap(display[i]));
@@ -348,39 +431,21 @@ void XTouch::SendSingleDial(unsigned char n, int value)
 
 }
 
-void XTouch::ClearButtonLights()
+void XTouch::SendAllDials()
 {
     int i;
-    for(i=0;i<127;i++) {
-        mButtonLEDStates[i]=OFF;
+    for(i=0;i<8;i++) {
+        SendSingleDial(i, mDialValues[i]);
     }
-    SendAllButtons();
 }
 
-void XTouch::PushLightState(bool reset)
+void XTouch::ClearButtonLights()
 {
-    xt_button_state_t *buffer = new xt_button_state_t[127];
-    for(int i = 0; i < 127; i++) {
-        buffer[i] = mButtonLEDStates[i];
-    }
-    mButtonLEDStack.push_back(buffer);
-
-    if (!reset) { return; }
-    for(int i=0;i<127;i++) {
+    int i;
+    for(i=0;i<127;i++) {
         mButtonLEDStates[i]=OFF;
     }
-    SendAllButtons();
-}
-
-void XTouch::PopLightState()
-{
-    auto buffer = mButtonLEDStack.back();
-    mButtonLEDStack.pop_back();
-    for(int i = 0; i < 127; i++) {
-        mButtonLEDStates[i] = buffer[i];
-    }
-    free(buffer);
-    SendAllButtons();
+    m_allButtonsDirty=true;
 }
 
 void XTouch::SendAllScribble()
@@ -436,14 +501,34 @@ void XTouch::SendAllButtons() {
 void XTouch::SendAllBoard() {
     SendAllButtons();
     SendAllFaders();
+    SendAllDials();
     SendAllScribble();
     SendSegments();
 }
 
+// What a packet sent to the X-Touch carries, by its status byte
+static Metric ByteCategory(const unsigned char *buffer, unsigned int len) {
+    switch (buffer[0]) {
+        case 0x90: return Metric::XT_BYTES_LED;
+        case 0xd0: return Metric::XT_BYTES_METER;
+        case 0xb0: return len > 1 && buffer[1] >= 0x60 ? Metric::XT_BYTES_SEGMENT : Metric::XT_BYTES_DIAL;
+        case 0xf0: return len > 5 && buffer[4] == 0x58 && (buffer[5] & 0xf8) == 0x20 ? Metric::XT_BYTES_SCRIBBLE : Metric::XT_BYTES_OTHER;
+        default: return (buffer[0] & 0xf0) == 0xe0 ? Metric::XT_BYTES_FADER : Metric::XT_BYTES_OTHER;
+    }
+}
+
 void XTouch::SendPacket(unsigned char *buffer, unsigned int len)
 {
-    for(int i = 0; i < 70000; i++) {}
+    TraceSpan span("XTouch::SendPacket");
+    g_metrics->Add(ByteCategory(buffer, len), len);
+    // The surface needs a breather between packets. Spun on the real clock, the gap is about the wire and
+    // must not wait for a virtual clock, and a timed spin survives the optimiser where an empty loop did not
+    if (m_packetGap.count() > 0) {
+        auto earliest = m_lastPacket + m_packetGap;
+        while (std::chrono::steady_clock::now() < earliest) {}
+    }
     if (m_packetCallBack) { m_packetCallBack(buffer, len); }
+    if (m_packetGap.count() > 0) { m_lastPacket = std::chrono::steady_clock::now(); }
 
 }
 
@@ -463,6 +548,8 @@ int XTouch::HandleLevel(unsigned char *buffer, unsigned int len) {
     if ((len==3)&&((buffer[0]&0xf0)==0xe0)) {
         channel=buffer[0]&0x0f;
         level=buffer[1]+(buffer[2]<<7);
+        // The fader is physically at this level now, so the motor does not need to be sent there
+        if (channel<=8) mFaderLevels[channel]=level;
         if (m_faderCallBack) m_faderCallBack(channel, level);
         return 1;
     }
@@ -493,7 +580,13 @@ int XTouch::HandleButton(unsigned char *buffer, unsigned int len) {
 
 int XTouch::HandleProbe(unsigned char *buffer, unsigned int len) {
     if ((len==sizeof(probe))&&(memcmp(buffer, probe, sizeof(probe))==0)) {
-        if (!probe_sent) { probe_sent = true; SendPacket(proberesponse, sizeof(proberesponse)); }
+        if (!probe_sent) {
+            probe_sent = true;
+            SendPacket(proberesponse, sizeof(proberesponse));
+            // Whatever was set before the surface connected, eg a warm start, is painted straight away
+            SendAllBoard();
+            if (m_connectCallBack) { m_connectCallBack(); }
+        }
         return 1;
     }
     if ((len==sizeof(probeb))&&(memcmp(buffer, probeb, sizeof(probeb))==0)) {
@@ -519,6 +612,8 @@ int XTouch::HandleUnknown(unsigned char *buffer, unsigned int len) {
 }
 
 int XTouch::HandlePacket(unsigned char *buffer, unsigned int len) {
+    TraceSpan span("XTouch::HandlePacket");
+    if (g_latency) { g_latency->Mark(LatencyStage::XT_HANDLE_PACKET); }
     CheckIdle();
     if (HandleProbe(buffer,len)>0) return 1;
     if (HandleFaderTouch(buffer,len)>0) return 1;
@@ -530,16 +625,18 @@ int XTouch::HandlePacket(unsigned char *buffer, unsigned int len) {
 }
 
 void XTouch::CheckIdle() {
-    if (mLastIdle!=time(NULL)) {
+    // Whole seconds of monotonic time, a wall clock step must not force or skip a refresh
+    time_t now = std::chrono::duration_cast<std::chrono::seconds>(Clock::now().time_since_epoch()).count();
+    if (mLastIdle!=now) {
         SendPacket(idlepacket, sizeof(idlepacket));
         if (mFullRefreshNeeded) {
             SendAllBoard();
             mFullRefreshNeeded=0;
         }
-        if (time(NULL)-mLastIdle>5) {
+        if (now-mLastIdle>5) {
             mFullRefreshNeeded=1;
         }
-    	mLastIdle=time(NULL);
+    	mLastIdle=now;
     }
 }
 
@@ -582,15 +679,4 @@ namespace ButtonUtils {
         if (button < FADER_0_SELECT || button > FADER_7_SELECT) { return -1; }
         return button - FADER_0_SELECT;
     }
-    bool AddressChangingButton(xt_buttons button) {
-        switch(button) {
-            case FADER_BANK_LEFT:
-            case FADER_BANK_RIGHT:
-            case CHANNEL_LEFT:
-            case CHANNEL_RIGHT:
-                return true;
-            default:
-                return false;
-        }
-    }
 }
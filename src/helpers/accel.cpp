@@ -0,0 +1,48 @@
+#include <accel.h>
+#include <cmath>
+#include <stdlib.h>
+
+constexpr DialAccelerator::Profile DialAccelerator::PROFILE_4XX;
+constexpr DialAccelerator::Profile DialAccelerator::PROFILE_3XX;
+constexpr DialAccelerator::Profile DialAccelerator::PROFILE_JOG;
+
+DialAccelerator::DialAccelerator(const Profile &profile) {
+    // The table spans 0 to twice the fast velocity, anything past the end uses the last entry
+    m_velocityStep = (profile.fastVelocity * 2.0f) / (TABLE_SIZE - 1);
+    for(uint32_t i = 0; i < TABLE_SIZE; i++) {
+        float velocity = i * m_velocityStep;
+        float t = (velocity - profile.slowVelocity) / (profile.fastVelocity - profile.slowVelocity);
+        t = fminf(fmaxf(t, 0.0f), 1.0f);
+        m_gainTable[i] = profile.minGain + (profile.maxGain - profile.minGain) * powf(t, profile.exponent);
+    }
+    m_lastTick = time_point();
+}
+
+float DialAccelerator::Gain(float velocity) {
+    uint32_t index = static_cast<uint32_t>(velocity / m_velocityStep + 0.5f);
+    if (index >= TABLE_SIZE) { index = TABLE_SIZE - 1; }
+    return m_gainTable[index];
+}
+
+void DialAccelerator::Tick(int ticks, time_point now) {
+    using namespace std::chrono;
+    if (ticks == 0) { return; }
+
+    auto elapsed = duration_cast<microseconds>(now - m_lastTick).count();
+    m_lastTick = now;
+    if (elapsed <= 0 || elapsed > IDLE_RESET_MS * 1000) {
+        // First tick of a gesture, there is no interval to measure yet
+        m_velocity = 0.0f;
+    } else {
+        float sample = abs(ticks) * 1000000.0f / elapsed;
+        m_velocity = SMOOTHING * sample + (1.0f - SMOOTHING) * m_velocity;
+    }
+
+    m_pending += ticks * Gain(m_velocity);
+}
+
+float DialAccelerator::TakePending() {
+    float pending = m_pending;
+    m_pending = 0.0f;
+    return pending;
+}
@@ -0,0 +1,158 @@
+#include <clock.h>
+#include <thread>
+#include <algorithm>
+
+Clock::time_point SteadyClock::Now() {
+    return time_point(std::chrono::duration_cast<duration>(std::chrono::steady_clock::now().time_since_epoch()));
+}
+
+void SteadyClock::SleepUntil(time_point deadline) {
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(deadline.time_since_epoch()));
+}
+
+void SteadyClock::Wait(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, time_point deadline) {
+    if (deadline == time_point::max()) {
+        condition.wait(lock);
+        return;
+    }
+    condition.wait_until(lock, std::chrono::steady_clock::time_point(deadline.time_since_epoch()));
+}
+
+VirtualClock::VirtualClock(time_point start) : m_now(start.time_since_epoch().count()) {}
+
+Clock::time_point VirtualClock::Now() {
+    return time_point(duration(m_now.load()));
+}
+
+uint64_t VirtualClock::BeginWait(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, time_point deadline) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    uint64_t id = m_nextWaiter++;
+    m_waiters.push_back({ id, &condition, lock.mutex(), std::this_thread::get_id(), deadline });
+    return id;
+}
+
+void VirtualClock::EndWait(uint64_t id) {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    for(size_t i = 0; i < m_waiters.size(); i++) {
+        if (m_waiters[i].id != id) { continue; }
+        m_waiters[i] = m_waiters.back();
+        m_waiters.pop_back();
+        break;
+    }
+    SetRunning(std::this_thread::get_id(), true);
+}
+
+// Caller holds m_mutex
+void VirtualClock::SetRunning(std::thread::id thread, bool running) {
+    auto found = std::find(m_running.begin(), m_running.end(), thread);
+    if (running) {
+        if (found == m_running.end()) { m_running.push_back(thread); }
+        return;
+    }
+    if (found == m_running.end()) { return; }
+    *found = m_running.back();
+    m_running.pop_back();
+    if (m_running.empty()) { m_settledCondition.notify_all(); }
+}
+
+// Caller holds m_mutex
+VirtualClock::Waiter* VirtualClock::FindWaiter(uint64_t id) {
+    for(auto &waiter : m_waiters) {
+        if (waiter.id == id) { return &waiter; }
+    }
+    return nullptr;
+}
+
+void VirtualClock::SleepUntil(time_point deadline) {
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    WaitUntil(m_sleepCondition, lock, deadline, [] { return false; });
+}
+
+// The waiter registered before it first checked the time and holds its mutex until it blocks, see AdvanceTo.
+// It is running until it blocks, so a Settle waits for it
+void VirtualClock::Wait(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, time_point deadline) {
+    if (Now() >= deadline) { return; }
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        SetRunning(std::this_thread::get_id(), false);
+    }
+    condition.wait(lock);
+}
+
+void VirtualClock::NotifyOne(std::condition_variable &condition) {
+    NotifyAll(condition); // Knowing which waiter wakes would take a queue per condition
+}
+
+void VirtualClock::NotifyAll(std::condition_variable &condition) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(auto &waiter : m_waiters) {
+            if (waiter.condition == &condition) { SetRunning(waiter.thread, true); }
+        }
+    }
+    condition.notify_all();
+}
+
+void VirtualClock::Advance(duration step) {
+    AdvanceTo(Now() + step);
+}
+
+void VirtualClock::AdvanceTo(time_point target) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    AdvanceLocked(lock, target);
+}
+
+void VirtualClock::AdvanceLocked(std::unique_lock<std::mutex> &lock, time_point target) {
+    if (target <= Now()) { return; } // Time never goes backwards
+    m_now.store(target.time_since_epoch().count());
+
+    std::vector<uint64_t> due;
+    for(auto &waiter : m_waiters) {
+        if (waiter.deadline <= target) { due.push_back(waiter.id); }
+    }
+    // A waiter holding its mutex has not blocked yet, it may have read the old time. Notifying under
+    // its mutex reaches it once it blocks. Waiters lock m_mutex with their mutex held, so only try
+    // theirs here and let go of m_mutex between attempts. A waiter still registered is still alive.
+    while (!due.empty()) {
+        for(size_t i = 0; i < due.size();) {
+            Waiter *waiter = FindWaiter(due[i]);
+            if (waiter != nullptr && !waiter->mutex->try_lock()) { i++; continue; }
+            if (waiter != nullptr) {
+                SetRunning(waiter->thread, true);
+                waiter->condition->notify_all();
+                waiter->mutex->unlock();
+            }
+            due[i] = due.back();
+            due.pop_back();
+        }
+        if (due.empty()) { break; }
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+    }
+}
+
+void VirtualClock::Settle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_settledCondition.wait(lock, [this] { return m_running.empty(); });
+}
+
+bool VirtualClock::AdvanceToNextDeadline() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_settledCondition.wait(lock, [this] { return m_running.empty(); });
+    time_point next = time_point::max();
+    for(auto &waiter : m_waiters) { next = std::min(next, waiter.deadline); }
+    if (next == time_point::max()) { return false; }
+    AdvanceLocked(lock, next);
+    return true;
+}
+
+void VirtualClock::Leave() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SetRunning(std::this_thread::get_id(), false);
+}
+
+size_t VirtualClock::Waiting() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_waiters.size();
+}
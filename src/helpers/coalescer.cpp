@@ -0,0 +1,136 @@
+#include <coalescer.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <latency.h>
+
+InputCoalescer::InputCoalescer(Config config) :
+    m_config(config),
+    m_frame(std::chrono::milliseconds(config.frameInterval))
+{
+    for(auto &last : m_lastEmit) { last = time_point(); }
+}
+
+bool InputCoalescer::Absorb(const PhysicalEvent &event, time_point now) {
+    Control *control;
+    uint32_t index;
+    switch (event.type) {
+        case PhysicalEventType::FADER:
+        {
+            index = event.data.faderDial.Column;
+            assert(index < PHYSICAL_CHANNEL_COUNT);
+            control = &m_faders[index];
+            control->value = event.data.faderDial.value;
+            m_faderCounter.in.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        case PhysicalEventType::MASTER:
+        {
+            index = PHYSICAL_CHANNEL_COUNT;
+            control = &m_faders[index];
+            control->value = event.data.master.value;
+            m_masterCounter.in.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        case PhysicalEventType::DIAL:
+        {
+            assert(event.data.faderDial.Column < PHYSICAL_CHANNEL_COUNT);
+            index = FADER_COUNT + event.data.faderDial.Column;
+            control = &m_dials[event.data.faderDial.Column];
+            control->value += event.data.faderDial.value;
+            m_dialCounter.in.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        default:
+        {
+            return false;
+        }
+    }
+
+    control->lastInput = now;
+    if (!control->pending) {
+        control->pending = true;
+        control->origin = LatencyTracer::Origin();
+        control->due = std::max(now, m_lastEmit[index] + m_frame);
+    }
+    return true;
+}
+
+// Moves smaller than the dead-band are held back while the fader is still moving,
+// once it settles the exact resting position is always sent
+bool InputCoalescer::FaderReady(Control &control, time_point now, bool force) {
+    if (force || control.emitted < 0) { return true; }
+    if (abs(control.value - control.emitted) >= static_cast<int>(m_config.faderDeadband)) { return true; }
+    return now - control.lastInput >= m_frame;
+}
+
+void InputCoalescer::Flush(time_point now, const std::function<void(const PhysicalEvent&)> &emit, bool force) {
+    for(uint32_t i = 0; i < FADER_COUNT; i++) {
+        auto &control = m_faders[i];
+        if (!control.pending || (!force && now < control.due)) { continue; }
+        if (!FaderReady(control, now, force)) { control.due = now + m_frame; continue; }
+
+        control.pending = false;
+        if (control.value == control.emitted) { continue; } // Came back to where it was
+
+        PhysicalEvent event;
+        if (i == PHYSICAL_CHANNEL_COUNT) {
+            event.type = PhysicalEventType::MASTER;
+            event.data.master.value = control.value;
+            m_masterCounter.out.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            event.type = PhysicalEventType::FADER;
+            event.data.faderDial.Column = i;
+            event.data.faderDial.value = control.value;
+            m_faderCounter.out.fetch_add(1, std::memory_order_relaxed);
+        }
+        control.emitted = control.value;
+        m_lastEmit[i] = now;
+        LatencyTracer::SetOrigin(control.origin);
+        emit(event);
+    }
+
+    for(uint32_t i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
+        auto &control = m_dials[i];
+        if (!control.pending || (!force && now < control.due)) { continue; }
+
+        control.pending = false;
+        int delta = control.value;
+        control.value = 0;
+        if (delta == 0) { continue; } // Turned back and forth within the frame
+
+        PhysicalEvent event;
+        event.type = PhysicalEventType::DIAL;
+        event.data.faderDial.Column = i;
+        event.data.faderDial.value = delta;
+        m_dialCounter.out.fetch_add(1, std::memory_order_relaxed);
+        m_lastEmit[FADER_COUNT + i] = now;
+        LatencyTracer::SetOrigin(control.origin);
+        emit(event);
+    }
+}
+
+InputCoalescer::time_point InputCoalescer::Deadline() {
+    auto deadline = time_point::max();
+    for(auto &control : m_faders) {
+        if (control.pending && control.due < deadline) { deadline = control.due; }
+    }
+    for(auto &control : m_dials) {
+        if (control.pending && control.due < deadline) { deadline = control.due; }
+    }
+    return deadline;
+}
+
+void InputCoalescer::Report(FILE *out) {
+    Report(out, "faders", m_faderCounter);
+    Report(out, "master", m_masterCounter);
+    Report(out, "dials", m_dialCounter);
+}
+
+void InputCoalescer::Report(FILE *out, const char *name, Counter &counter) {
+    uint64_t in = counter.in.load(std::memory_order_relaxed);
+    uint64_t out_count = counter.out.load(std::memory_order_relaxed);
+    double collapsed = in == 0 ? 0.0 : 100.0 * (in - out_count) / in;
+    fprintf(out, "[Input] %-6s in=%llu out=%llu collapsed=%.1f%%\n", name,
+        (unsigned long long)in, (unsigned long long)out_count, collapsed);
+}
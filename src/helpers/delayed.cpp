@@ -1,84 +1,131 @@
 #include <delayed.h>
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <trace.h>
+
 DelayedExecuter::DelayedExecuter() {
     m_thread = std::thread(&DelayedExecuter::_threadimpl, this);
     m_thread.detach();
-
 }
 
-void DelayedExecuter::_wait() {
-    std::unique_lock<std::mutex> lock(m_mutex_note);
-    m_suspended = true;
-    m_condition.wait(lock, [this] { return !m_suspended; });
-}
+void DelayedExecuter::_threadimpl() {
+    Tracer::NameThread("Delayed executer");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        if (m_deadlines.empty()) {
+            g_clock->WaitUntil(m_condition, lock, clock::time_point::max());
+            continue;
+        }
+        auto next = m_deadlines.front();
+        if (clock::now() < next.when) {
+            g_clock->WaitUntil(m_condition, lock, next.when);
+            continue; // Woken early for an earlier deadline, or spuriously
+        }
 
-void DelayedExecuter::_maybe_wake() {
-    std::unique_lock<std::mutex> lock(m_mutex_note);
-    if (!m_suspended) { return; } // Thread is not suspended, no need to wake it up
+        std::pop_heap(m_deadlines.begin(), m_deadlines.end(), Later());
+        m_deadlines.pop_back();
+        auto &registration = m_registrations[next.id];
+        if (!registration.pending || registration.generation != next.generation) { continue; } // Cancelled
+        if (next.when < registration.deadline) { // Pushed back since it was queued
+            _push(next.id, registration.deadline);
+            continue;
+        }
 
-    m_suspended = false;
-    m_condition.notify_all();    
+        registration.pending = false;
+        auto callback = registration.callback;
+        float value = registration.value;
+        lock.unlock();
+        {
+            TraceSpan span("DelayedExecuter callback");
+            callback(value);
+        }
+        lock.lock();
+    }
 }
 
-void DelayedExecuter::_threadimpl() {
-    using namespace std::chrono;
+// Caller holds m_mutex
+void DelayedExecuter::_schedule(RegistrationId id, time_point when) {
+    auto &registration = m_registrations[id];
+    bool queued = registration.pending && registration.deadline <= when; // Its entry comes up first and is moved then
+    registration.deadline = when;
+    if (queued) { return; }
 
-    while (true) {
-        bool hasActive = false;
-        {
-            std::lock_guard<std::mutex> lock(m_mutex_data);
-            auto now = clock::now();
-            for (auto &execution : m_delayedExecutions) {
-                if (!execution.active) { continue; } else { hasActive = true; }
+    registration.generation++; // An earlier entry would fire too late, drop it
+    registration.pending = true;
+    _push(id, when);
+}
 
-                auto duration = duration_cast<milliseconds>(now - execution.lastTime).count();
-                if (duration >= execution.delayDuration) {
-                    execution.active = false;
-                    execution.callback(execution.value);
-                }
-            }
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(25));
-        if(!hasActive) { _wait(); }
-    }
+// Caller holds m_mutex
+void DelayedExecuter::_push(RegistrationId id, time_point when) {
+    bool earliest = m_deadlines.empty() || when < m_deadlines.front().when;
+    m_deadlines.push_back({ when, id, m_registrations[id].generation });
+    std::push_heap(m_deadlines.begin(), m_deadlines.end(), Later());
+    if (earliest) { g_clock->NotifyOne(m_condition); }
 }
 
 RegistrationId DelayedExecuter::Register(std::function<void(float)> callback, uint32_t delayDuration) {
-    std::lock_guard<std::mutex> lock(m_mutex_data);
-    Execution execution;
-    execution.id = m_delayedExecutions.size();
-    execution.active = false;
-    execution.delayDuration = delayDuration;
-    execution.lastTime = clock::now();
-    execution.callback = callback;
-    m_delayedExecutions.push_back(execution);
+    assert(callback);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    RegistrationId id;
+    if (!m_free.empty()) {
+        id = m_free.back();
+        m_free.pop_back();
+    } else {
+        id = m_registrations.size();
+        m_registrations.emplace_back();
+    }
 
-    return execution.id;
+    auto &registration = m_registrations[id];
+    registration.callback = callback;
+    registration.delayDuration = delayDuration;
+    registration.value = NAN; // The first Update always schedules
+    registration.pending = false;
+    return id;
+}
+
+void DelayedExecuter::Unregister(RegistrationId id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(id < m_registrations.size() && m_registrations[id].callback);
+    auto &registration = m_registrations[id];
+    registration.callback = nullptr;
+    registration.pending = false;
+    registration.generation++;
+    m_free.push_back(id);
 }
 
 // Update the value of a delayed execution, only if the value has changed
 void DelayedExecuter::Update(RegistrationId id, float value) {
-    std::lock_guard<std::mutex> lock(m_mutex_data);
-    auto &execution = m_delayedExecutions[id];
-
-    if (execution.value == value) { return; }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(id < m_registrations.size() && m_registrations[id].callback);
+    auto &registration = m_registrations[id];
+    if (registration.value == value) { return; }
 
-    execution.value = value;
-    execution.lastTime = clock::now(); // Reset time when turning active 
-
-    if (!execution.active) { 
-        execution.active = true;
-    }
-
-    _maybe_wake();
+    registration.value = value;
+    _schedule(id, clock::now() + std::chrono::milliseconds(registration.delayDuration));
 }
 
 void DelayedExecuter::ForcedUpdate(RegistrationId id, float value) {
-    std::lock_guard<std::mutex> lock(m_mutex_data);
-    auto &execution = m_delayedExecutions[id];
-
-    if (execution.value == value) { return; }
+    std::function<void(float)> callback;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        assert(id < m_registrations.size() && m_registrations[id].callback);
+        auto &registration = m_registrations[id];
+        if (registration.value == value) { return; }
+
+        registration.value = value;
+        registration.pending = false; // Its deadline is now stale
+        registration.generation++;
+        callback = registration.callback;
+    }
+    callback(value);
+}
 
-    execution.value = value;
-    execution.active = false;
-    execution.callback(execution.value);
-}
\ No newline at end of file
+void DelayedExecuter::Cancel(RegistrationId id) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(id < m_registrations.size());
+    auto &registration = m_registrations[id];
+    if (!registration.pending) { return; }
+    registration.pending = false;
+    registration.generation++;
+}
@@ -0,0 +1,61 @@
+#include <histogram.h>
+
+uint32_t LatencyHistogram::BucketIndex(uint64_t micros) {
+    if (micros < SUB_BUCKETS) { return micros; }
+
+    uint32_t msb = 63 - __builtin_clzll(micros);
+    uint32_t shift = msb - SUB_BUCKET_BITS;
+    uint32_t sub = (micros >> shift) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS + shift * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(uint32_t index) {
+    if (index < SUB_BUCKETS) { return index; }
+
+    uint32_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    uint64_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    uint64_t lower = (SUB_BUCKETS + sub) << shift;
+    return lower + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t micros) {
+    m_buckets[BucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (micros > max && !m_max.compare_exchange_weak(max, micros, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::Reset() {
+    for (auto &bucket : m_buckets) { bucket.store(0, std::memory_order_relaxed); }
+    m_count.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Count() {
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Max() {
+    return m_max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Percentile(double percentile) {
+    uint64_t count = Count();
+    if (count == 0) { return 0; }
+
+    uint64_t target = (uint64_t)(count * (percentile / 100.0));
+    if (target == 0) { target = 1; }
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            // Never report past the largest value actually recorded
+            uint64_t bound = BucketUpperBound(i);
+            uint64_t max = Max();
+            return bound < max ? bound : max;
+        }
+    }
+    return Max();
+}
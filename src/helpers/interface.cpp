@@ -1,6 +1,8 @@
 #include <interface.h>
 #include <standard.h>
 #include <stdio.h>
+#include <latency.h>
+#include <trace.h>
 
 class BaseLayer : public InterfaceLayer {
 public:
@@ -46,16 +48,22 @@ bool BaseLayer::HandleInput(PhysicalEvent event) {
             printf("[BaseLayer] Jog hit, state = %d\n", event.data.jog.value);
             break;
         }
+        case PhysicalEventType::FADER_TOUCH: {
+            printf("[BaseLayer] Fader %u touch, state = %d\n", event.data.faderTouch.Column, event.data.faderTouch.touched);
+            break;
+        }
     }
     return true;
 }
 
-InterfaceManager::InterfaceManager(XTouch *xtouch) {
+InterfaceManager::InterfaceManager(XTouch *xtouch) : m_xtouch(xtouch) {
     xtouch->RegisterButtonCallback([&](unsigned char button, int attr){ ReceiveButton(button, attr); });
     xtouch->RegisterDialCallback([&](unsigned char button, int attr){ ReceiveDial(button, attr); });
     xtouch->RegisterFaderCallback([&](unsigned char button, int attr){ ReceiveFader(button, attr); });
+    xtouch->RegisterFaderTouch([&](unsigned char fader, int touched){ ReceiveFaderTouch(fader, touched); });
 
     m_layers.push_back(new BaseLayer()); // Base layer
+    RebuildRoutes();
 }
 
 void InterfaceManager::ReceiveButton(unsigned char button, int attr) 
@@ -136,28 +144,87 @@ void InterfaceManager::ReceiveFader(unsigned char button, int attr)
     DispatchEvent(event);
 }
 
+void InterfaceManager::ReceiveFaderTouch(unsigned char fader, int touched) 
+{
+    assert(fader >= 0 && fader <= PHYSICAL_CHANNEL_COUNT);
+
+    PhysicalEvent event;
+    event.type = PhysicalEventType::FADER_TOUCH;
+    event.data.faderTouch.Column = fader;
+    event.data.faderTouch.touched = touched;
+    DispatchEvent(event);
+}
+
+uint32_t InterfaceManager::RouteIndex(const PhysicalEvent &event) {
+    if (event.type != PhysicalEventType::BUTTON) { return static_cast<uint32_t>(event.type); }
+    assert(event.data.button.Id < BUTTON_ROUTE_COUNT);
+    return PHYSICAL_EVENT_TYPE_COUNT + event.data.button.Id;
+}
+
 void InterfaceManager::DispatchEvent(PhysicalEvent event) {
-    for(auto it = m_layers.rbegin(); it != m_layers.rend(); ++it) {
-        if ((*it)->HandleInput(event)) {
+    TraceSpan span("InterfaceManager::DispatchEvent");
+    if (g_latency) { g_latency->Mark(LatencyStage::XT_DISPATCH); }
+    auto &route = m_routes[RouteIndex(event)];
+    // Indexed, a handler may push or pop a layer, which rebuilds the route
+    for(size_t i = 0; i < route.size(); i++) {
+        if (route[i]->HandleInput(event)) {
+            if (g_latency) { g_latency->Mark(LatencyStage::XT_HANDLED); }
             return;
         }
     }
     assert(false && "No layer handled the event");
 }
 
+void InterfaceManager::RebuildRoutes() {
+    for(auto &route : m_routes) { route.clear(); }
+
+    for(auto it = m_layers.rbegin(); it != m_layers.rend(); ++it) {
+        InputRoutes routes;
+        (*it)->DeclareRoutes(routes);
+        for(uint32_t type = 0; type < PHYSICAL_EVENT_TYPE_COUNT; type++) {
+            if (routes.types.test(type)) { m_routes[type].push_back(*it); }
+        }
+        for(uint32_t id = 0; id < BUTTON_ROUTE_COUNT; id++) {
+            if (routes.buttons.test(id)) { m_routes[PHYSICAL_EVENT_TYPE_COUNT + id].push_back(*it); }
+        }
+    }
+}
+
 void InterfaceManager::PushLayer(InterfaceLayer *layer) {
     auto top = m_layers.back();
     top->Pause();
     m_layers.push_back(layer);
+    RebuildRoutes();
+    m_stackChanged = true;
     layer->Start();
 }
 
 void InterfaceManager::PopLayer() {
     auto layer = m_layers.back();
     m_layers.pop_back();
-    
+    RebuildRoutes();
+    m_stackChanged = true;
+
     layer->Removed();
     assert(m_layers.size() > 0); // We should always have at the base layer
 
     m_layers.back()->Resume();
 }
+
+void InterfaceManager::FlushLights() {
+    bool changed = m_stackChanged;
+    for(auto layer : m_layers) {
+        changed |= layer->m_lights.m_changed;
+        layer->m_lights.m_changed = false;
+    }
+    if (!changed) { return; }
+    m_stackChanged = false;
+
+    for(uint32_t button = 0; button < BUTTON_ROUTE_COUNT; button++) {
+        xt_button_state_t state = OFF;
+        for(auto it = m_layers.rbegin(); it != m_layers.rend(); ++it) {
+            if ((*it)->m_lights.Covers(button)) { state = (*it)->m_lights.State(button); break; }
+        }
+        m_xtouch->SetSingleButton(button, state); // Only marks the LED dirty when its state changed
+    }
+}
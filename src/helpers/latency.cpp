@@ -0,0 +1,38 @@
+#include <latency.h>
+
+const char* LatencyTracer::Name(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::XT_HANDLE_PACKET: return "xt.handle_packet";
+        case LatencyStage::XT_DISPATCH: return "xt.dispatch";
+        case LatencyStage::XT_HANDLED: return "xt.handled";
+        case LatencyStage::XT_MA_SEND: return "xt.ma_send";
+        case LatencyStage::MA_APPLY: return "ma.apply";
+        case LatencyStage::MA_XT_SEND: return "ma.xt_send";
+        default: return "unknown";
+    }
+}
+
+void LatencyTracer::Mark(LatencyStage stage) {
+    if (s_origin == time_point()) { return; }
+    Record(stage, s_origin);
+}
+
+void LatencyTracer::Record(LatencyStage stage, time_point origin) {
+    using namespace std::chrono;
+    auto elapsed = duration_cast<microseconds>(Clock::now() - origin).count();
+    m_stages[static_cast<uint32_t>(stage)].Record(elapsed < 0 ? 0 : elapsed);
+}
+
+void LatencyTracer::Dump(FILE *out) {
+    for(uint32_t i = 0; i < static_cast<uint32_t>(LatencyStage::COUNT); i++) {
+        auto &histogram = m_stages[i];
+        fprintf(out, "[Latency] %-18s count=%lu p50=%luus p99=%luus max=%luus\n",
+            Name(static_cast<LatencyStage>(i)),
+            histogram.Count(),
+            histogram.Percentile(50),
+            histogram.Percentile(99),
+            histogram.Max()
+        );
+    }
+    fflush(out);
+}
@@ -0,0 +1,73 @@
+#include <mailbox.h>
+#include <string.h>
+
+static_assert((Mailbox::CAPACITY & (Mailbox::CAPACITY - 1)) == 0, "Mailbox capacity must be a power of two");
+
+Mailbox::Mailbox() {
+    m_cells = new Cell[CAPACITY];
+    for(uint64_t i = 0; i < CAPACITY; i++) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+Mailbox::~Mailbox() {
+    delete[] m_cells;
+}
+
+bool Mailbox::Post(CommandType type, const void *data, uint32_t size, uint64_t version, Clock::time_point origin) {
+    if (size > Command::MAX_SIZE) { m_dropped++; return false; }
+
+    // A cell is free for position `pos` when its sequence equals `pos`,
+    // producers race to claim it by advancing the tail
+    Cell *cell;
+    uint64_t pos = m_tail.load(std::memory_order_relaxed);
+    while(true) {
+        cell = &m_cells[pos & (CAPACITY - 1)];
+        uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int64_t diff = (int64_t)sequence - (int64_t)pos;
+        if (diff == 0) {
+            if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+        } else if (diff < 0) {
+            m_dropped++; // The consumer is a full lap behind
+            return false;
+        } else {
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->command.type = type;
+    cell->command.size = size;
+    cell->command.version = version;
+    cell->command.origin = origin;
+    memcpy(cell->command.data, data, size);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    // Pairs with the fence in Wait, either the consumer sees the command or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_mutex_wake);
+        m_woken = true;
+        g_clock->NotifyOne(m_condition);
+    }
+    return true;
+}
+
+void Mailbox::Wait(clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(m_mutex_wake);
+    m_woken = false;
+    m_sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (Empty()) {
+        g_clock->WaitUntil(m_condition, lock, deadline, [this] { return m_woken; });
+    }
+    m_sleeping.store(false, std::memory_order_relaxed);
+}
+
+uint64_t Mailbox::Dropped() {
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+bool Mailbox::Empty() {
+    return m_cells[m_head & (CAPACITY - 1)].sequence.load(std::memory_order_acquire) != m_head + 1;
+}
@@ -0,0 +1,110 @@
+#include <metrics.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+const Metrics::Descriptor Metrics::DESCRIPTORS[] = {
+    { "xctl_xt_datagrams_in_total", false, "Datagrams received from the X-Touch" },
+    { "xctl_xt_datagrams_out_total", false, "Datagrams sent to the X-Touch" },
+    { "xctl_ma_datagrams_in_total", false, "Datagrams received from the MA plugin" },
+    { "xctl_ma_datagrams_out_total", false, "Datagrams sent to the MA plugin" },
+    { "xctl_xt_bytes_led_total", false, "Button LED bytes sent to the X-Touch" },
+    { "xctl_xt_bytes_fader_total", false, "Motor fader bytes sent to the X-Touch" },
+    { "xctl_xt_bytes_dial_total", false, "Dial ring bytes sent to the X-Touch" },
+    { "xctl_xt_bytes_scribble_total", false, "Scribble strip bytes sent to the X-Touch" },
+    { "xctl_xt_bytes_meter_total", false, "Meter bytes sent to the X-Touch" },
+    { "xctl_xt_bytes_segment_total", false, "Segment display bytes sent to the X-Touch" },
+    { "xctl_xt_bytes_other_total", false, "Probe and keep-alive bytes sent to the X-Touch" },
+    { "xctl_xt_packets_dropped_total", false, "X-Touch packets dropped because the mailbox was full" },
+    { "xctl_ma_timeouts_total", false, "Refresh requests MA did not answer in time" },
+    { "xctl_ma_seq_mismatches_total", false, "MA responses to an earlier request" },
+    { "xctl_ma_stale_responses_total", false, "MA responses for channels no longer shown" },
+    { "xctl_ma_responses_dropped_total", false, "MA responses dropped because a queue was full" },
+    { "xctl_mailbox_depth", true, "Commands waiting when the controller thread woke" },
+    { "xctl_ma_queue_depth", true, "MA responses waiting to be read" },
+    { "xctl_loop_utilisation_permille", true, "Share of the last second the controller thread was busy" },
+};
+
+Metrics::~Metrics() {
+    if (m_socket >= 0) { shutdown(m_socket, SHUT_RDWR); }
+    if (m_thread.joinable()) { m_thread.join(); }
+    if (m_socket >= 0) { close(m_socket); }
+}
+
+size_t Metrics::Snapshot(char *buffer, size_t size) const {
+    static_assert(sizeof(DESCRIPTORS) / sizeof(DESCRIPTORS[0]) == static_cast<size_t>(Metric::COUNT), "Every metric needs a descriptor");
+    size_t length = 0;
+    for(uint32_t i = 0; i < static_cast<uint32_t>(Metric::COUNT) && length < size; i++) {
+        auto &descriptor = DESCRIPTORS[i];
+        int written = snprintf(buffer + length, size - length, "# HELP %s %s\n# TYPE %s %s\n%s %lu\n",
+            descriptor.name, descriptor.help,
+            descriptor.name, descriptor.gauge ? "gauge" : "counter",
+            descriptor.name, Get(static_cast<Metric>(i))
+        );
+        if (written < 0) { break; }
+        length += written;
+    }
+    return length < size ? length : size - 1; // snprintf truncated the last entry
+}
+
+bool Metrics::Serve(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("[Metrics] Socket path %s is too long\n", path);
+        return false;
+    }
+    strcpy(address.sun_path, path);
+
+    m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_socket < 0) {
+        printf("[Metrics] Could not create a socket\n");
+        return false;
+    }
+    // A socket that still answers belongs to a running controller, only one left behind by an earlier run is replaced
+    if (connect(m_socket, (struct sockaddr*)&address, sizeof(address)) == 0) {
+        printf("[Metrics] %s is served by another controller, not serving metrics\n", path);
+        close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+    close(m_socket);
+    m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_socket < 0) {
+        printf("[Metrics] Could not create a socket\n");
+        return false;
+    }
+    unlink(path);
+    if (bind(m_socket, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(m_socket, 4) != 0) {
+        printf("[Metrics] Could not bind %s\n", path);
+        close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+    m_thread = std::thread(&Metrics::Accept, this);
+    printf("[Metrics] Serving on %s\n", path);
+    return true;
+}
+
+void Metrics::Accept() {
+    char buffer[8192];
+    while(true) {
+        int client = accept(m_socket, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) { continue; }
+            return; // Shut down
+        }
+        size_t length = Snapshot(buffer, sizeof(buffer));
+        size_t sent = 0;
+        while(sent < length) {
+            ssize_t written = send(client, buffer + sent, length - sent, MSG_NOSIGNAL);
+            if (written <= 0) { break; }
+            sent += written;
+        }
+        close(client);
+    }
+}
@@ -0,0 +1,155 @@
+#include <profile.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using KeyType = IPC::ButtonEvent::KeyType;
+
+bool operator==(const ButtonAction& a, const ButtonAction& b) {
+    return a.type == b.type && a.value == b.value;
+}
+
+namespace {
+    struct NamedValue {
+        const char *name;
+        uint32_t value;
+    };
+
+#define NAMED(prefix, name) { #name, static_cast<uint32_t>(prefix::name) }
+    // Fader strip buttons (0 - 39) are not listed, they always belong to their channel
+    const NamedValue BUTTON_NAMES[] = {
+        NAMED(xt_buttons, ENCODER_TRACK), NAMED(xt_buttons, ENCODER_PAN_SUR), NAMED(xt_buttons, ENCODER_EQ),
+        NAMED(xt_buttons, ENCODER_SEND), NAMED(xt_buttons, ENCODER_PLUGIN), NAMED(xt_buttons, ENCODER_INST),
+        NAMED(xt_buttons, FADER_BANK_LEFT), NAMED(xt_buttons, FADER_BANK_RIGHT),
+        NAMED(xt_buttons, CHANNEL_LEFT), NAMED(xt_buttons, CHANNEL_RIGHT),
+        NAMED(xt_buttons, FLIP), NAMED(xt_buttons, GLOBAL_VIEW),
+        NAMED(xt_buttons, FUNCTION_F1), NAMED(xt_buttons, FUNCTION_F2), NAMED(xt_buttons, FUNCTION_F3),
+        NAMED(xt_buttons, FUNCTION_F4), NAMED(xt_buttons, FUNCTION_F5), NAMED(xt_buttons, FUNCTION_F6),
+        NAMED(xt_buttons, FUNCTION_F7), NAMED(xt_buttons, FUNCTION_F8),
+        NAMED(xt_buttons, MIDI_TRACKS), NAMED(xt_buttons, INPUTS), NAMED(xt_buttons, AUDIO_TRACKS),
+        NAMED(xt_buttons, AUDIO_INST), NAMED(xt_buttons, AUX), NAMED(xt_buttons, BUSES),
+        NAMED(xt_buttons, OUTPUTS), NAMED(xt_buttons, USER),
+        NAMED(xt_buttons, MODIFY_SHIFT), NAMED(xt_buttons, MODIFY_OPTION),
+        NAMED(xt_buttons, MODIFY_CONTROL), NAMED(xt_buttons, MODIFY_ALT),
+        NAMED(xt_buttons, AUTOMATION_READ), NAMED(xt_buttons, AUTOMATION_WRITE), NAMED(xt_buttons, AUTOMATION_TRIM),
+        NAMED(xt_buttons, AUTOMATION_TOUCH), NAMED(xt_buttons, AUTOMATION_LATCH), NAMED(xt_buttons, AUTOMATION_GROUP),
+        NAMED(xt_buttons, UTILITY_SAVE), NAMED(xt_buttons, UTILITY_UNDO),
+        NAMED(xt_buttons, UTILITY_CANCEL), NAMED(xt_buttons, UTILITY_ENTER),
+        NAMED(xt_buttons, TRANSPORT_MARKER), NAMED(xt_buttons, TRANSPORT_NUDGE), NAMED(xt_buttons, TRANSPORT_CYCLE),
+        NAMED(xt_buttons, TRANSPORT_DROP), NAMED(xt_buttons, TRANSPORT_REPLACE), NAMED(xt_buttons, TRANSPORT_CLICK),
+        NAMED(xt_buttons, TRANSPORT_SOLO),
+        NAMED(xt_buttons, PLAYBACK_REWIND), NAMED(xt_buttons, PLAYBACK_FAST_FORWARD), NAMED(xt_buttons, PLAYBACK_STOP),
+        NAMED(xt_buttons, PLAYBACK_PLAY), NAMED(xt_buttons, PLAYBACK_RECORD),
+        NAMED(xt_buttons, CURSOR_UP), NAMED(xt_buttons, CURSOR_DOWN), NAMED(xt_buttons, CURSOR_LEFT),
+        NAMED(xt_buttons, CURSOR_RIGHT), NAMED(xt_buttons, CURSOR_MIDDLE),
+        NAMED(xt_buttons, SCRUB),
+    };
+    const NamedValue KEY_NAMES[] = {
+        NAMED(KeyType, CLEAR), NAMED(KeyType, STORE), NAMED(KeyType, UPDATE),
+        NAMED(KeyType, ASSIGN), NAMED(KeyType, MOVE), NAMED(KeyType, OOPS),
+        NAMED(KeyType, EDIT), NAMED(KeyType, DELETE), NAMED(KeyType, ESC),
+    };
+#undef NAMED
+
+    constexpr uint32_t FIRST_SYSTEM_BUTTON = FADER_7_DIAL_PRESS + 1;
+    constexpr uint32_t LAST_SYSTEM_BUTTON = xt_buttons::SCRUB;
+
+    template<size_t N>
+    bool FindName(const NamedValue (&table)[N], const char *name, uint32_t &value) {
+        for(auto &entry : table) {
+            if (strcasecmp(entry.name, name) == 0) { value = entry.value; return true; }
+        }
+        return false;
+    }
+
+    bool ParseButton(const char *text, uint32_t &button) {
+        if (FindName(BUTTON_NAMES, text, button)) { return true; }
+        char *end;
+        unsigned long parsed = strtoul(text, &end, 10);
+        if (end == text || *end != '\0' || parsed < FIRST_SYSTEM_BUTTON || parsed > LAST_SYSTEM_BUTTON) { return false; }
+        button = parsed;
+        return true;
+    }
+
+    bool ParseDirection(const char *text, int32_t &direction) {
+        if (strcmp(text, "-1") == 0) { direction = -1; return true; }
+        if (strcmp(text, "1") == 0 || strcmp(text, "+1") == 0) { direction = 1; return true; }
+        return false;
+    }
+}
+
+ButtonProfile::ButtonProfile() {
+    m_actions[xt_alias_btn::CLEAR] = { ButtonActionType::MA_KEY, static_cast<int32_t>(KeyType::CLEAR) };
+    m_actions[xt_alias_btn::STORE] = { ButtonActionType::MA_KEY, static_cast<int32_t>(KeyType::STORE) };
+    m_actions[xt_alias_btn::UPDATE] = { ButtonActionType::MA_KEY, static_cast<int32_t>(KeyType::UPDATE) };
+    m_actions[xt_alias_btn::ASSIGN] = { ButtonActionType::MA_KEY, static_cast<int32_t>(KeyType::ASSIGN) };
+    m_actions[xt_alias_btn::MOVE] = { ButtonActionType::MA_KEY, static_cast<int32_t>(KeyType::MOVE) };
+    m_actions[xt_alias_btn::OOPS] = { ButtonActionType::MA_KEY, static_cast<int32_t>(KeyType::OOPS) };
+    m_actions[xt_alias_btn::EDIT] = { ButtonActionType::MA_KEY, static_cast<int32_t>(KeyType::EDIT) };
+    m_actions[xt_alias_btn::ESC] = { ButtonActionType::MA_KEY, static_cast<int32_t>(KeyType::ESC) };
+    m_actions[xt_alias_btn::DELETE] = { ButtonActionType::MA_KEY, static_cast<int32_t>(KeyType::DELETE) };
+
+    m_actions[xt_alias_btn::EXECUTER_SCROLL_LEFT] = ButtonActions::SCROLL_LEFT;
+    m_actions[xt_alias_btn::EXECUTER_SCROLL_RIGHT] = ButtonActions::SCROLL_RIGHT;
+    m_actions[xt_alias_btn::PAGE_DEC] = ButtonActions::PAGE_DEC;
+    m_actions[xt_alias_btn::PAGE_INC] = ButtonActions::PAGE_INC;
+    m_actions[xt_alias_btn::PIN] = ButtonActions::PIN_MODE;
+}
+
+bool ButtonProfile::Load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        printf("[Profile] Could not open %s\n", path);
+        return false;
+    }
+
+    ButtonAction actions[BUTTON_ROUTE_COUNT];
+    char line[256];
+    uint32_t line_number = 0;
+    const char *error = nullptr;
+    while(error == nullptr && fgets(line, sizeof(line), file)) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment) { *comment = '\0'; }
+
+        char button_text[64], action_text[32], argument[64];
+        int fields = sscanf(line, "%63s %31s %63s", button_text, action_text, argument);
+        if (fields <= 0) { continue; } // Blank or comment only
+
+        uint32_t button;
+        if (!ParseButton(button_text, button)) { error = "unknown button"; break; }
+        if (fields < 2) { error = "missing action"; break; }
+
+        ButtonAction action;
+        if (strcmp(action_text, "none") == 0) {
+            action.type = ButtonActionType::NONE;
+        } else if (strcmp(action_text, "pin") == 0) {
+            action = ButtonActions::PIN_MODE;
+        } else if (strcmp(action_text, "ma") == 0) {
+            uint32_t key;
+            if (fields < 3 || !FindName(KEY_NAMES, argument, key)) { error = "expected an MA key name"; break; }
+            action = { ButtonActionType::MA_KEY, static_cast<int32_t>(key) };
+        } else if (strcmp(action_text, "scroll") == 0 || strcmp(action_text, "page") == 0) {
+            action.type = action_text[0] == 's' ? ButtonActionType::SCROLL : ButtonActionType::PAGE;
+            if (fields < 3 || !ParseDirection(argument, action.value)) { error = "expected -1 or 1"; break; }
+        } else {
+            error = "unknown action";
+            break;
+        }
+        actions[button] = action;
+    }
+    fclose(file);
+
+    if (error) {
+        printf("[Profile] %s:%u: %s\n", path, line_number, error);
+        return false;
+    }
+    memcpy(m_actions, actions, sizeof(m_actions));
+    return true;
+}
+
+void ButtonProfile::AddRoutes(InputRoutes &routes, ButtonActionType type) const {
+    for(uint32_t i = 0; i < BUTTON_ROUTE_COUNT; i++) {
+        if (m_actions[i].type == type) { routes.AddButton(i); }
+    }
+}
@@ -0,0 +1,98 @@
+#include <rtt.h>
+#include <assert.h>
+
+RoundTripTracker::RoundTripTracker() {
+    for (auto &slot : m_slots) {
+        slot.state = SlotState::EMPTY;
+    }
+}
+
+RoundTripTracker::Stats &RoundTripTracker::StatsFor(IPC::PacketType::Type type) {
+    assert(type >= IPC::PacketType::REQ_ENCODERS && type < IPC::PacketType::END);
+    return m_stats[type - IPC::PacketType::REQ_ENCODERS];
+}
+
+void RoundTripTracker::Sent(IPC::PacketType::Type type, uint32_t seq) {
+    auto now = clock::now();
+    StatsFor(type).sent.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &slot = m_slots[seq % WINDOW];
+    // Slot is being reused before its echo arrived
+    if (slot.state == SlotState::IN_FLIGHT) {
+        StatsFor(slot.type).lost.fetch_add(1, std::memory_order_relaxed);
+    }
+    slot.seq = seq;
+    slot.type = type;
+    slot.state = SlotState::IN_FLIGHT;
+    slot.sentAt = now;
+}
+
+void RoundTripTracker::Received(IPC::PacketType::Type type, uint32_t seq) {
+    using namespace std::chrono;
+    auto now = clock::now();
+    auto &stats = StatsFor(type);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (seq < m_highestEcho) {
+        stats.outOfOrder.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        m_highestEcho = seq;
+    }
+
+    auto &slot = m_slots[seq % WINDOW];
+    if (slot.seq != seq || slot.state == SlotState::EMPTY) { return; } // Too old to match, or never sent by us
+
+    switch (slot.state) {
+        case SlotState::IN_FLIGHT: {
+            slot.state = SlotState::ECHOED;
+            stats.echoed.fetch_add(1, std::memory_order_relaxed);
+            stats.rtt.Record(duration_cast<microseconds>(now - slot.sentAt).count());
+            break;
+        }
+        case SlotState::EXPIRED: {
+            slot.state = SlotState::ECHOED;
+            stats.late.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        default: { break; } // Duplicate echo
+    }
+}
+
+// Must be called with m_mutex held
+void RoundTripTracker::Expire(time_point now) {
+    using namespace std::chrono;
+    for (auto &slot : m_slots) {
+        if (slot.state != SlotState::IN_FLIGHT) { continue; }
+        if (duration_cast<milliseconds>(now - slot.sentAt).count() < LOSS_TIMEOUT_MS) { continue; }
+
+        slot.state = SlotState::EXPIRED;
+        StatsFor(slot.type).lost.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void RoundTripTracker::Report(FILE *out) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Expire(clock::now());
+    }
+
+    for (uint32_t i = 0; i < TYPE_COUNT; i++) {
+        auto &stats = m_stats[i];
+        auto sent = stats.sent.load(std::memory_order_relaxed);
+        if (sent == 0) { continue; }
+
+        auto type = static_cast<IPC::PacketType::Type>(IPC::PacketType::REQ_ENCODERS + i);
+        fprintf(out, "[RTT] %-22s sent=%lu echoed=%lu lost=%lu late=%lu ooo=%lu p50=%.2fms p99=%.2fms max=%.2fms\n",
+            IPC::PacketType::Name(type),
+            sent,
+            stats.echoed.load(std::memory_order_relaxed),
+            stats.lost.load(std::memory_order_relaxed),
+            stats.late.load(std::memory_order_relaxed),
+            stats.outOfOrder.load(std::memory_order_relaxed),
+            stats.rtt.Percentile(50) / 1000.0,
+            stats.rtt.Percentile(99) / 1000.0,
+            stats.rtt.Max() / 1000.0
+        );
+    }
+}
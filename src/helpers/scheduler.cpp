@@ -0,0 +1,79 @@
+#include <scheduler.h>
+#include <algorithm>
+#include <stdio.h>
+
+RefreshScheduler::RefreshScheduler(Config config) : m_config(config) {
+    m_interval = m_config.activeInterval;
+    m_lastChange = clock::now();
+}
+
+void RefreshScheduler::NoteActivity() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastChange = clock::now();
+    // A failing plugin stays in backoff, touching the surface won't bring it back any faster
+    if (m_mode != Mode::IDLE) { return; }
+
+    m_interval = m_config.activeInterval;
+    SetMode(Mode::ACTIVE);
+    m_woken = true;
+    g_clock->NotifyAll(m_condition);
+}
+
+void RefreshScheduler::NoteResult(bool success, bool changed) {
+    using namespace std::chrono;
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!success) {
+        // 100, 200, 400 ... capped at maxFailureInterval
+        auto shift = std::min<uint32_t>(m_failures, 16);
+        m_interval = std::min(m_config.failureInterval << shift, m_config.maxFailureInterval);
+        m_failures++;
+        SetMode(Mode::BACKOFF);
+        return;
+    }
+    m_failures = 0;
+
+    auto now = clock::now();
+    if (changed || m_mode == Mode::BACKOFF) { m_lastChange = now; }
+
+    auto quiet = duration_cast<milliseconds>(now - m_lastChange).count();
+    if (quiet < m_config.idleAfter) {
+        m_interval = m_config.activeInterval;
+        SetMode(Mode::ACTIVE);
+        return;
+    }
+
+    // Nothing has changed for a while, slow down gradually so a single
+    // change right after going quiet is still picked up quickly
+    m_interval = std::min(m_interval * 2, m_config.idleInterval);
+    SetMode(Mode::IDLE);
+}
+
+void RefreshScheduler::Wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_woken = false;
+    g_clock->WaitFor(m_condition, lock, std::chrono::milliseconds(m_interval), [this] { return m_woken; });
+}
+
+uint32_t RefreshScheduler::CurrentInterval() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_interval;
+}
+
+float RefreshScheduler::CurrentRate() {
+    return 1000.0f / CurrentInterval();
+}
+
+RefreshScheduler::Mode RefreshScheduler::CurrentMode() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_mode;
+}
+
+// Must be called with m_mutex held
+void RefreshScheduler::SetMode(Mode mode) {
+    if (m_mode == mode) { return; }
+    m_mode = mode;
+
+    const char *names[] = { "active", "idle", "backoff" };
+    printf("[Refresh] Polling %s, %.1f Hz\n", names[static_cast<int>(mode)], 1000.0f / m_interval);
+}
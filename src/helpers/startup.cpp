@@ -0,0 +1,33 @@
+#include <startup.h>
+#include <stdio.h>
+
+StartupTimer::StartupTimer() : m_start(Clock::now()) {
+    for(auto &elapsed : m_elapsed) { elapsed.store(-1, std::memory_order_relaxed); }
+}
+
+const char* StartupTimer::Name(Phase phase) {
+    switch (phase) {
+        case SERVERS_BOUND: return "servers bound";
+        case GROUP_READY: return "channel group ready";
+        case XTOUCH_CONNECTED: return "X-Touch connected";
+        case PLUGIN_READY: return "plugin ready";
+        case FIRST_REFRESH: return "first refresh";
+        default: return "unknown";
+    }
+}
+
+void StartupTimer::Mark(Phase phase) {
+    using namespace std::chrono;
+    int64_t elapsed = duration_cast<microseconds>(Clock::now() - m_start).count();
+    int64_t unset = -1;
+    if (!m_elapsed[phase].compare_exchange_strong(unset, elapsed)) { return; }
+    printf("[Startup] %s after %.1f ms\n", Name(phase), elapsed / 1000.0);
+
+    if (Reached(XTOUCH_CONNECTED) && Reached(FIRST_REFRESH) && !m_usableLogged.exchange(true)) {
+        printf("[Startup] Surface usable after %.1f ms\n", elapsed / 1000.0);
+    }
+}
+
+bool StartupTimer::Reached(Phase phase) const {
+    return m_elapsed[phase].load() >= 0;
+}
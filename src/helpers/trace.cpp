@@ -0,0 +1,64 @@
+#include <trace.h>
+#include <stdio.h>
+
+void Tracer::Record(const char *name, char phase) {
+    Buffer *buffer = s_buffer ? s_buffer : CreateBuffer();
+    uint32_t count = buffer->count.load(std::memory_order_relaxed); // Only this thread writes it
+    if (count == EVENTS_PER_THREAD) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto &event = buffer->events[count];
+    event.name = name;
+    event.time = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start).count();
+    event.phase = phase;
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+Tracer::Buffer* Tracer::CreateBuffer() {
+    std::lock_guard<std::mutex> lock(m_mutex_buffers);
+    auto buffer = std::make_unique<Buffer>();
+    buffer->tid = m_buffers.size() + 1;
+    buffer->threadName = s_threadName ? s_threadName : "unnamed";
+    s_buffer = buffer.get();
+    m_buffers.push_back(std::move(buffer));
+    return s_buffer;
+}
+
+bool Tracer::Write(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+        printf("[Trace] Could not open %s\n", path);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex_buffers);
+    uint64_t written = 0;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for(auto &buffer : m_buffers) {
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n",
+            buffer->tid, buffer->threadName);
+    }
+    const char *separator = "";
+    for(auto &buffer : m_buffers) {
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for(uint32_t i = 0; i < count; i++) {
+            auto &event = buffer->events[i];
+            // Instant events are scoped to their thread, "s":"t"
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u%s}",
+                separator, event.name, event.phase, event.time / 1000.0, buffer->tid, event.phase == 'i' ? ",\"s\":\"t\"" : "");
+            separator = ",\n";
+            written++;
+        }
+    }
+    if (written == 0) { fprintf(file, "{\"name\":\"empty\",\"ph\":\"i\",\"ts\":0,\"pid\":1,\"tid\":0,\"s\":\"g\"}"); }
+    fprintf(file, "\n]}\n");
+    bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed) {
+        printf("[Trace] Could not write %s\n", path);
+        return false;
+    }
+    printf("[Trace] Wrote %lu events to %s, %lu dropped\n", written, path, m_dropped.load());
+    return true;
+}
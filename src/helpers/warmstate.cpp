@@ -0,0 +1,103 @@
+#include <warmstate.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+WarmState::~WarmState() {
+    if (m_mapped) { munmap(m_file, sizeof(File)); }
+    if (m_fd >= 0) { close(m_fd); }
+}
+
+bool WarmState::Open(const char *path, uint32_t pageCount, uint32_t channelCount) {
+    Reset(pageCount, channelCount);
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        printf("[WarmState] Could not open %s, starting cold\n", path);
+        return false;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        printf("[WarmState] %s is in use by another controller, starting cold\n", path);
+        close(fd);
+        return false;
+    }
+
+    struct stat info;
+    bool sized = fstat(fd, &info) == 0 && info.st_size == sizeof(File);
+    if (!sized && ftruncate(fd, sizeof(File)) != 0) {
+        printf("[WarmState] Could not size %s, starting cold\n", path);
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, sizeof(File), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        printf("[WarmState] Could not map %s, starting cold\n", path);
+        close(fd);
+        return false;
+    }
+    m_fd = fd;
+    m_file = static_cast<File*>(mapping);
+    m_mapped = true;
+
+    bool restored = sized &&
+        m_file->magic == MAGIC &&
+        m_file->size == sizeof(File) &&
+        m_file->pageCount == pageCount &&
+        m_file->channelCount == channelCount;
+    if (!restored) {
+        Reset(pageCount, channelCount);
+        return false;
+    }
+    return true;
+}
+
+void WarmState::Reset(uint32_t pageCount, uint32_t channelCount) {
+    memset(m_file, 0, sizeof(File));
+    m_file->size = sizeof(File);
+    m_file->pageCount = pageCount;
+    m_file->channelCount = channelCount;
+    m_file->page = 1;
+    m_file->magic = MAGIC;
+}
+
+void WarmState::StoreLayout(uint32_t page, uint32_t channelOffset, const Address (&addresses)[PHYSICAL_CHANNEL_COUNT], const bool (&pinned)[PHYSICAL_CHANNEL_COUNT]) {
+    m_file->page = page;
+    m_file->channelOffset = channelOffset;
+    for(uint32_t i = 0; i < PHYSICAL_CHANNEL_COUNT; i++) {
+        auto &channel = m_file->channels[i];
+        channel.pinned = pinned[i];
+        if (channel.address.mainAddress == addresses[i].mainAddress && channel.address.subAddress == addresses[i].subAddress) { continue; }
+        // The data belongs to the previous executor
+        channel.state = ChannelState::UNKNOWN;
+        channel.address = addresses[i];
+    }
+}
+
+void WarmState::StoreChannel(uint32_t channel, const IPC::PlaybackRefresh::Data *data) {
+    assert(channel < PHYSICAL_CHANNEL_COUNT);
+    auto &stored = m_file->channels[channel];
+    if (data == nullptr) {
+        stored.state = ChannelState::INACTIVE;
+        return;
+    }
+    // Write generations mean nothing to the next process
+    IPC::PlaybackRefresh::Data copy = *data;
+    for(auto &encoder : copy.Encoders) { encoder.generation = 0; }
+
+    // Values and names rarely change between refreshes, leave the page clean when they don't
+    if (stored.state == ChannelState::ACTIVE && memcmp(&stored.data, &copy, sizeof(copy)) == 0) { return; }
+    stored.data = copy;
+    stored.state = ChannelState::ACTIVE;
+}
+
+void WarmState::StoreMaster(float value) {
+    if (m_file->masterValid && m_file->master == value) { return; }
+    m_file->master = value;
+    m_file->masterValid = 1;
+}
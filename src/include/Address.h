@@ -7,3 +7,4 @@ struct Address {
 
 };
 bool operator<(const Address& a, const Address& b);
+bool operator==(const Address& a, const Address& b);
@@ -8,6 +8,9 @@
 #include <guards.h>
 #include <maserver.h>
 #include <chrono>
+#include <clock.h>
+#include <accel.h>
+#include <interface.h>
 
 enum class EncoderId {
     Fader, SoundMeter, Dial,
@@ -16,7 +19,7 @@ enum class EncoderId {
 
 class Encoder {
 private:
-    using clock = std::chrono::system_clock;
+    using clock = Clock;
     using time_point = std::chrono::time_point<clock>;
 
     float m_value;
@@ -24,12 +27,24 @@ private:
     std::string m_name;
     const uint32_t PHYSICAL_CHANNEL_ID;
     time_point m_lastPhysicalChange;
-    uint32_t m_delayTime;
+    uint32_t m_writeGeneration = 0; // Latest physical write MA has not confirmed yet, 0 if none
+    bool m_touched = false; // Operator's hand is on the fader, it owns the value
+    static uint32_t s_nextGeneration; // Shared by every encoder, so generations are unique per executor
 
 public:
+    static constexpr uint32_t FEEDBACK_TIMEOUT_MS = 1000; // Follow MA again if a write is never confirmed
+
     Encoder(EncoderId type, uint32_t id);
     float GetValue();
-    void SetValue(float value, bool physical);
+    // Physical changes start a new write generation. Feedback from MA (physical = false) is ignored
+    // until `generation` shows MA has applied the latest write.
+    void SetValue(float value, bool physical, uint32_t generation = 0);
+    uint32_t WriteGeneration();
+    // Forget the outstanding write, used when the encoder is moved to another executor
+    void ResetGeneration();
+    // While touched, MA feedback is dropped so the motor never fights the operator
+    void SetTouched(bool touched);
+    bool IsTouched();
     bool SetName(std::string name);
     std::string GetName();
     void SetActive(bool state);
@@ -48,17 +63,34 @@ private:
     MaUDPServer *m_maServer;
     bool m_toggle = false;
     void UpdateDial(int value);
-    std::chrono::time_point<std::chrono::system_clock> m_lastPhysicalChange;
-    Observer<xt_colours_t> *m_scribbleColour;
-    Observer<std::string> *m_scribbleBottomText;
+    void SendDial(IPC::PlaybackRefresh::EncoderType type, float delta);
+    DialAccelerator m_dialAccel[2] = { DialAccelerator(DialAccelerator::PROFILE_4XX), DialAccelerator(DialAccelerator::PROFILE_3XX) };
+    Clock::time_point m_lastPhysicalChange;
+    int m_faderLevel = 0; // Last raw level reported by the physical fader
+    bool m_movedWhileTouched = false;
+
+    // The scribble pad is sent once per transaction, however many of its parts changed
+    void OnScribbleChange(const xt_ScribblePad_t &pad);
+    void OnScribbleColourChange(const xt_colours_t &colour);
+    void OnScribbleTextChange(const std::string &text);
+    void OnAddressChange(const Address &address);
+    template<typename T, void (Channel::*Method)(const T&)>
+    using ChannelObserver = Observer<T, MemberCallback<Channel, T, Method>>;
+
+    ChannelObserver<xt_ScribblePad_t, &Channel::OnScribbleChange> *m_scribble;
+    ChannelObserver<xt_colours_t, &Channel::OnScribbleColourChange> *m_scribbleColour;
+    ChannelObserver<std::string, &Channel::OnScribbleTextChange> *m_scribbleBottomText;
     Encoder& GetEncoderRefFromType(IPC::PlaybackRefresh::EncoderType type);
 
 public:
     Channel(uint32_t id);
     // Updates internal value, and sends data to GrandMA3
     void UpdateEncoderFromXT(int value, bool isFader);
+    // Sends the dial movement accumulated since the last call, once per controller loop iteration
+    void FlushDial();
+    void SetFaderTouched(bool touched);
     // Updates value and fader based on GrandMA3 state
-    void UpdateEncoderFromMA(IPC::PlaybackRefresh::Data encoderr, bool updateButtonLights);
+    void UpdateEncoderFromMA(IPC::PlaybackRefresh::Data encoderr, LedScene &lights);
     void Pin(bool state);
     bool IsPinned();
     void Disable();
@@ -66,5 +98,5 @@ public:
     void Toggle();
 
     const uint32_t PHYSICAL_CHANNEL_ID;
-    Observer<Address> *m_address; // Virtual address / represents channel within MA
+    Observer<Address, MemberCallback<Channel, Address, &Channel::OnAddressChange>> *m_address; // Virtual address / represents channel within MA
 };
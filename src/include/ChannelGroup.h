@@ -10,6 +10,12 @@
 #include <delayed.h>
 #include <chrono>
 #include <interface.h>
+#include <scheduler.h>
+#include <seqlock.h>
+#include <coalescer.h>
+#include <profile.h>
+#include <warmstate.h>
+#include <string>
 
 enum class UpdateType {
     FADER,
@@ -18,15 +24,35 @@ enum class UpdateType {
     MASTER
 };
 
+struct ChannelGroupConfig {
+    uint32_t pageCount = DEFAULT_PAGE_COUNT; // Pages 1..pageCount, at most MAX_PAGE_COUNT
+    uint32_t channelCount = DEFAULT_CHANNEL_COUNT; // Executors 1..channelCount per page, at most MAX_CHANNEL_COUNT
+    RefreshScheduler::Config refresh;
+    InputCoalescer::Config input;
+    ButtonProfile buttons;
+    std::string stateFile; // Warm start state, empty to always start cold
+};
+
+// Addresses shown on the physical channels, published to the refresh thread as one snapshot
+struct ChannelAddressSnapshot {
+    Address channels[PHYSICAL_CHANNEL_COUNT];
+};
+
 class ChannelGroup {
 public:
-    ChannelGroup();
+    ChannelGroup(ChannelGroupConfig config = ChannelGroupConfig());
     void UpdateFader(uint32_t channel, float value);
     void ChangePage(int32_t pageOffset); 
     void ScrollPage(int32_t scrollOffset);
     void RegisterMaSend(MaUDPServer *server); // Temporary, will be removed after refactoring
-    std::vector<Address> CurrentChannelAddress();
+    uint64_t CurrentChannelAddress(ChannelAddressSnapshot &snapshot);
     void UpdateEncoderFromMA(IPC::PlaybackRefresh::Data encoder, uint32_t physical_channel_id);
+    void ApplyRefresh(char *buffer, uint32_t size, uint64_t generation);
+    // Sends input accumulated during the current controller loop iteration, and applies a settled jog target
+    void FlushPendingInput();
+    // When FlushPendingInput next has coalesced input to send or navigation to apply
+    InputCoalescer::time_point InputDeadline();
+    void ReportInput(FILE *out);
     void DisablePhysicalChannel(uint32_t channel);
 
     void HandleUpdate(UpdateType type, char button, int value);
@@ -36,9 +62,12 @@ public:
 
     void UpdateEncoderFromXT(uint32_t physical_channel_id, int value, bool isFader);
     void UpdateMasterEncoder(int value);
+    void SetMasterTouched(bool touched);
     bool InPinMode();
 
 private:
+    friend struct BenchmarkAccess;
+    friend struct ChannelWindowsAccess;
     struct GroupInterfaceLayer : public InterfaceLayer {
         ChannelGroup *m_group;
         void Resume() override;
@@ -46,6 +75,7 @@ private:
         void Start() override;
         void Removed() override;
         GroupInterfaceLayer(ChannelGroup *group) : m_group(group) {};
+        void DeclareRoutes(InputRoutes &routes) override;
         bool HandleInput(PhysicalEvent event) override;
         std::function<bool(PhysicalEvent)> cb_HandleInput;
         friend class ChannelGroup;
@@ -53,44 +83,85 @@ private:
 
     struct PinInterfaceLayer : public InterfaceLayer {
         Channel *m_channels;
+        const ButtonProfile &m_buttons;
         void Resume() override;
         void Pause() override;
         void Start() override;
         void Removed() override;
+        void DeclareRoutes(InputRoutes &routes) override;
         bool HandleInput(PhysicalEvent event) override;
         void UpdateLights();
-        PinInterfaceLayer(Channel *channels) : m_channels(channels) {};
+        PinInterfaceLayer(Channel *channels, const ButtonProfile &buttons) : m_channels(channels), m_buttons(buttons) {};
     };
 
     GroupInterfaceLayer *m_interfaceLayer;
 
     void TogglePinConfigMode();
+    uint32_t CountPinned(uint32_t page, uint32_t &pinned, uint32_t *onPage);
     void GenerateChannelWindows();
-    void HandleAddressChange(xt_alias_btn btn);
+    uint32_t WindowChannel(uint32_t window, uint32_t slot);
+    void ApplyChannelWindow();
+    void PublishChannelAddresses();
+    void RestoreWarmState();
+    bool ValidAddress(const Address &address);
+    void HandleButtonAction(const ButtonAction &action);
     void RefreshPlaybacks();
     bool RefreshPlaybacksImpl();
     bool HandlePhysicalEvent(PhysicalEvent event);
+    bool DispatchInput(PhysicalEvent event);
+    void FlushInput(bool force);
     void HandleFaderButton(ButtonUtils::ButtonInfo info, bool down);
-    void SetLight(char button, xt_button_state_t state);
-    void PredicateSetLight(bool condition, char button, xt_button_state_t state);
+    void SetLight(ButtonAction action, xt_button_state_t state);
+    void PredicateSetLight(bool condition, ButtonAction action, xt_button_state_t state);
     void RefreshPageChannelLights();
+    void ShowPage(uint32_t page);
+    uint32_t WindowCount(uint32_t page);
+    void HandleJog(int ticks);
+    struct NavigationTarget;
+    NavigationTarget& BeginNavigation(uint32_t settle);
+    void MoveNavigationTarget(int32_t windows);
+    void FlushNavigation(InputCoalescer::time_point now, bool force);
 
     // CBs
-    MaUDPServer *m_maServer;
+    MaUDPServer *m_maServer = nullptr;
     std::function<void(char*, uint32_t)> cb_Send; // Temporary, will be removed after refactoring
 
     // "Other"
     Channel *m_channels;
     Encoder *m_masterFaderEncoder;
-    std::vector<std::vector<uint32_t>> m_channelWindows;
+    const uint32_t m_pageCount;
+    const uint32_t m_channelCount;
+    // Window geometry, windows are resolved arithmetically from the channels pinned on the current page
+    uint32_t m_pinnedOnPage[PHYSICAL_CHANNEL_COUNT]; // Sorted ascending
+    uint32_t m_pinnedOnPageCount = 0;
+    uint32_t m_windowWidth = PHYSICAL_CHANNEL_COUNT; // Number of unpinned physical channels
     std::thread m_playbackRefresh;
+    RefreshScheduler m_refreshScheduler;
+    InputCoalescer m_input;
+    const ButtonProfile m_buttons;
+    WarmState m_warmState;
+    char m_lastResponse[4096]; // Last MA response, used to detect when values stop changing
+    ssize_t m_lastResponseSize = 0;
 
     bool m_pinConfigMode = false;
     Observer<uint32_t> *m_page; // Concrete concept
 
     uint32_t m_channelOffset = 0; // Offset is relative based on number of channels pinned
-    uint32_t m_channelOffsetEnd = 0; // Final m_channelWindows index
+    uint32_t m_channelOffsetEnd = 0; // Final window index
+
+    // Navigation input moves this target instead of the surface, it is painted and fetched once the input settles
+    struct NavigationTarget {
+        uint32_t page;
+        uint32_t offset;
+    };
+    NavigationTarget m_navTarget;
+    bool m_navPending = false;
+    InputCoalescer::time_point m_navDeadline;
+    DialAccelerator m_jogAccel = DialAccelerator(DialAccelerator::PROFILE_JOG);
+    bool m_jogging = false; // The open navigation includes jog ticks
+    float m_jogRemainder = 0.0f; // Fraction of a window carried to the next tick
     float m_masterFader = 0.0f;
-    uint32_t m_sequence = 0;
-    bool m_blockUpdates = false;
+    int m_masterLevel = 0; // Last raw level reported by the physical master fader
+    bool m_masterMovedWhileTouched = false;
+    Seqlock<ChannelAddressSnapshot> m_addressTable; // Version changes whenever the surface is navigated
 };
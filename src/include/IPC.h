@@ -13,15 +13,42 @@ namespace IPC {
             UPDATE_MA_MASTER = 0x8004,
             PRESS_MA_PLAYBACK_KEY = 0x8005,
             PRESS_MA_SYSTEM_KEY = 0x8006,
-            END = 0x8007,
+            ACK = 0x8007, // Plugin echo of any packet that has no other response
+            HELLO = 0x8008, // Sent by the controller at startup until the plugin ACKs it
+            END = 0x8009,
         };
+
+        inline const char *Name(Type type) {
+            switch (type) {
+                case REQ_ENCODERS: return "REQ_ENCODERS";
+                case RESP_ENCODERS_META: return "RESP_ENCODERS_META";
+                case UPDATE_MA_ENCODER: return "UPDATE_MA_ENCODER";
+                case UPDATE_MA_MASTER: return "UPDATE_MA_MASTER";
+                case PRESS_MA_PLAYBACK_KEY: return "PRESS_MA_PLAYBACK_KEY";
+                case PRESS_MA_SYSTEM_KEY: return "PRESS_MA_SYSTEM_KEY";
+                case ACK: return "ACK";
+                case HELLO: return "HELLO";
+                default: return "UNKNOWN";
+            }
+        }
     }
 
+    // `seq` is assigned by MaUDPServer::Send for every outbound packet, and echoed
+    // back by the plugin in either the response or an ACK
     IPC_STRUCT IPCHeader {
         PacketType::Type type;
         uint32_t seq;
     };
 
+    namespace Ack {
+        // =============================================
+        // ==================== ACK ====================
+        // =============================================
+        IPC_STRUCT Data {
+            PacketType::Type type; // Type of the packet being acknowledged
+        };
+    }
+
     namespace PlaybackRefresh {
         enum class EncoderType : uint16_t {
             x100 = 0x100,
@@ -46,6 +73,7 @@ namespace IPC {
         // =============================================
         IPC_STRUCT ChannelMetadata {
             float master; // Master fader
+            uint32_t masterGeneration; // Latest UPDATE_MA_MASTER generation reflected in `master`
             bool channelActive[8]; // True if channel/playback has any active encoders or keys
         }; 
 
@@ -58,21 +86,26 @@ namespace IPC {
                 bool isActive;
                 char key_name[8];
                 float value;
+                uint32_t generation; // Latest UPDATE_MA_ENCODER generation reflected in `value`, 0 if never written
             } Encoders[3]; // 4xx, 3xx, 2xx encoders
             bool keysActive[4]; // 4xx, 3xx, 2xx, 1xx keys are being used
         };
     }
 
     namespace EncoderUpdate {
+        // Every write carries a generation, which the plugin reports back with the executor's value once
+        // GetFader reflects the write. Generations are unique across executors and never 0.
         IPC_STRUCT Data {
             uint16_t page;
             uint8_t channel; // eg x01, x02, x03
             uint16_t encoderType; // 400, 300, 200, 100
             float value;
+            uint32_t generation;
         };
 
         IPC_STRUCT MasterData {
             float value;
+            uint32_t generation;
         };
     }
 
@@ -1,20 +1,90 @@
 #pragma once
 #include <functional>
+#include <vector>
+#include <stdint.h>
 
-template<typename T>
-class Observer {
+class ObserverTransaction;
+
+class ObserverBase {
+public:
+    virtual ~ObserverBase() = default;
+
+protected:
+    friend class ObserverTransaction;
+    // Notifies the callback if the value differs from the one it was last given
+    virtual void Commit() = 0;
+    bool m_queued = false;
+};
+
+// Groups Observer::Set calls on this thread. Every observer changed while a transaction is open
+// fires its callback once, with its final value, when the outermost transaction goes out of scope.
+// Nested transactions join the outer one.
+class ObserverTransaction {
+public:
+    ObserverTransaction() { s_depth++; }
+    ~ObserverTransaction() {
+        if (s_depth > 1) { s_depth--; return; }
+
+        // Still open while committing, observers set by the callbacks are appended and fired in this same pass
+        for(size_t i = 0; i < s_queue.size(); i++) {
+            auto observer = s_queue[i];
+            observer->m_queued = false;
+            observer->Commit();
+        }
+        s_queue.clear();
+        s_depth--;
+    }
+    ObserverTransaction(const ObserverTransaction&) = delete;
+    ObserverTransaction& operator=(const ObserverTransaction&) = delete;
+
+    static bool Active() { return s_depth > 0; }
+    static void Enqueue(ObserverBase *observer) {
+        if (observer->m_queued) { return; }
+        observer->m_queued = true;
+        s_queue.push_back(observer);
+    }
+
+private:
+    inline static thread_local uint32_t s_depth = 0;
+    inline static thread_local std::vector<ObserverBase*> s_queue;
+};
+
+// Binds a member function at compile time, so fixed callbacks skip the std::function indirection
+template<typename Owner, typename T, void (Owner::*Method)(const T&)>
+struct MemberCallback {
+    Owner *owner;
+    void operator()(const T &value) const { (owner->*Method)(value); }
+};
+
+// Holds a value and calls back when it changes. Setting an equal value does nothing.
+// T needs operator==.
+template<typename T, typename Callback = std::function<void(const T&)>>
+class Observer : public ObserverBase {
     T stored_value;
-    std::function<void(T)> m_updateCb;
+    T m_notified; // Value the callback was last called with
+    Callback m_updateCb;
 public:
-    Observer(T value, std::function<void(T)> updateCb) {
-        m_updateCb = updateCb;
-        Set(value);
+    // The callback is always called once with the initial value
+    Observer(T value, Callback updateCb) : stored_value(value), m_notified(value), m_updateCb(updateCb) {
+        m_updateCb(m_notified);
     }
     T Get() {
         return stored_value;
     }
     void Set(T value) {
+        if (value == stored_value) { return; }
         stored_value = value;
-        m_updateCb(value);
+        if (ObserverTransaction::Active()) {
+            ObserverTransaction::Enqueue(this);
+            return;
+        }
+        Commit();
+    }
+
+protected:
+    void Commit() override {
+        if (stored_value == m_notified) { return; } // Changed and changed back within a transaction
+        m_notified = stored_value;
+        m_updateCb(m_notified);
     }
-};
\ No newline at end of file
+};
@@ -10,6 +10,7 @@
 #include <Channel.h>
 #include <ChannelGroup.h>
 #include <standard.h>
+#include <mailbox.h>
 
 
 namespace EncoderType {
@@ -25,6 +26,8 @@ namespace EncoderType {
 class XTouchController {
 public:
     XTouchController();
+    // Runs the controller loop on the calling thread, never returns
+    void Run();
 
 private:
     struct Address { uint32_t page; uint32_t offset; };
@@ -32,10 +35,14 @@ private:
 
     TCPServer *xt_server = nullptr;
     MaUDPServer ma_server;
-    ChannelGroup *m_group;
+    ChannelGroup *m_group = nullptr;
     std::thread m_watchDog;
+    uint64_t m_xtPacketsSent = 0;
+    const char *m_traceFile = nullptr; // XCTL_TRACE_FILE, written on SIGUSR2
+    Clock::time_point m_feedbackOrigin; // Oldest MA response applied since the last X-Touch flush, when latency tracing
 
     void WatchDog();
+    void Dispatch(Command &command);
     void SpawnServer(SpawnType type);
     bool HandleButton(xt_buttons btn, bool down);
 };
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <clock.h>
+
+// Velocity sensitive gain for the channel dials. Turning slowly moves the value in fine steps,
+// spinning the dial quickly covers the full range in one sweep. The gain curve is sampled into a
+// lookup table once, so a tick costs a table lookup rather than a pow.
+class DialAccelerator {
+public:
+    using clock = Clock;
+    using time_point = std::chrono::time_point<clock>;
+
+    struct Profile {
+        float minGain; // Percent per tick when turning slowly
+        float maxGain; // Percent per tick when spinning the dial
+        float slowVelocity; // Ticks per second at or below which minGain applies
+        float fastVelocity; // Ticks per second at or above which maxGain applies
+        float exponent; // Shape of the curve between the two, > 1 keeps more of the range fine
+    };
+    // 4xx executors are usually intensity style dials, 3xx get a flatter, coarser curve
+    static constexpr Profile PROFILE_4XX = { 0.25f, 4.0f, 10.0f, 120.0f, 2.0f };
+    static constexpr Profile PROFILE_3XX = { 0.5f, 5.0f, 10.0f, 100.0f, 1.5f };
+    // The jog wheel gains are executor windows per tick rather than percent
+    static constexpr Profile PROFILE_JOG = { 0.25f, 1.0f, 15.0f, 150.0f, 2.0f };
+
+    DialAccelerator(const Profile &profile);
+    // Accumulates `ticks` (signed, as reported by the X-Touch) using the current turning speed
+    void Tick(int ticks, time_point now);
+    // Returns the change accumulated since the last call, in percent, and clears it
+    float TakePending();
+    float Gain(float velocity);
+
+private:
+    static constexpr uint32_t TABLE_SIZE = 64;
+    static constexpr uint32_t IDLE_RESET_MS = 250; // A pause longer than this starts a new gesture
+    static constexpr float SMOOTHING = 0.5f; // Weight of the newest velocity sample
+
+    float m_gainTable[TABLE_SIZE];
+    float m_velocityStep; // Ticks per second covered by one table entry
+
+    float m_velocity = 0.0f;
+    float m_pending = 0.0f;
+    time_point m_lastTick;
+};
@@ -0,0 +1,132 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <thread>
+
+class Clock;
+extern Clock *g_clock;
+
+// Monotonic time for the whole controller. Everything that reads the time, sleeps or waits with a
+// timeout goes through g_clock, so a simulation can install a VirtualClock and run timers faster than real time.
+// Clock also meets the std::chrono clock requirements, `using clock = Clock` replaces steady_clock.
+class Clock {
+public:
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<Clock, duration>;
+    static constexpr bool is_steady = true;
+    static time_point now() { return g_clock->Now(); }
+
+    virtual ~Clock() = default;
+    virtual time_point Now() = 0;
+    virtual void SleepUntil(time_point deadline) = 0;
+    void SleepFor(duration timeout) { SleepUntil(Now() + timeout); }
+
+    // Like condition_variable::wait_until, returns when notified, when `deadline` passes or spuriously.
+    // time_point::max() waits for a notification only.
+    void WaitUntil(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, time_point deadline) {
+        uint64_t wait = BeginWait(condition, lock, deadline);
+        Wait(condition, lock, deadline);
+        EndWait(wait);
+    }
+    // Returns pred(), false means the deadline passed first
+    template<typename Pred>
+    bool WaitUntil(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, time_point deadline, Pred pred) {
+        uint64_t wait = BeginWait(condition, lock, deadline);
+        bool satisfied;
+        while (!(satisfied = pred())) {
+            if (Now() >= deadline) { break; }
+            Wait(condition, lock, deadline);
+        }
+        EndWait(wait);
+        return satisfied;
+    }
+    // Wake threads waiting on `condition` through the clock. Every wait loops on its condition, so a
+    // clock may wake more waiters than asked
+    virtual void NotifyOne(std::condition_variable &condition) { condition.notify_one(); }
+    virtual void NotifyAll(std::condition_variable &condition) { condition.notify_all(); }
+    template<typename Pred>
+    bool WaitFor(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, duration timeout, Pred pred) {
+        return WaitUntil(condition, lock, Now() + timeout, pred);
+    }
+
+protected:
+    // Bracket every timed wait, called with `lock` held. The returned id is passed to EndWait
+    virtual uint64_t BeginWait(std::condition_variable &, std::unique_lock<std::mutex> &, time_point) { return 0; }
+    virtual void EndWait(uint64_t) {}
+    // A single blocking wait on `condition`
+    virtual void Wait(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, time_point deadline) = 0;
+};
+
+// std::chrono::steady_clock, immune to wall clock adjustments
+class SteadyClock : public Clock {
+public:
+    time_point Now() override;
+    void SleepUntil(time_point deadline) override;
+
+protected:
+    void Wait(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, time_point deadline) override;
+};
+
+// Time only moves when Advance is called. Sleeps and timed waits return once virtual time reaches their
+// deadline, whatever the real time, so a simulation steps through timers in a fixed order.
+//
+// A thread counts as running from the moment it is woken, by Advance or by NotifyOne/NotifyAll, until it
+// blocks in a wait again. Advance notifies due waiters while holding their mutex, so no wake is lost
+// between a waiter checking the time and blocking. AdvanceToNextDeadline first lets every running thread
+// block, so it never jumps past a deadline a thread was about to wait on. A thread that stops using the
+// clock for good must call Leave.
+class VirtualClock : public Clock {
+public:
+    // Starts well past zero, so default constructed time points read as long ago
+    VirtualClock(time_point start = time_point(std::chrono::hours(1)));
+    time_point Now() override;
+    void SleepUntil(time_point deadline) override;
+
+    // Moves time forward and wakes the waiters now due. They run concurrently with the caller
+    void Advance(duration step);
+    void AdvanceTo(time_point target);
+    // Blocks until every thread that returned from a wait is waiting again
+    void Settle();
+    // Settles, then jumps to the earliest deadline any thread is sleeping or waiting on.
+    // Returns false, leaving the time unchanged, when nobody waits with a deadline.
+    bool AdvanceToNextDeadline();
+    // Stops counting the calling thread as running
+    void Leave();
+    // Threads currently waiting, a driver can wait for this before it starts stepping
+    size_t Waiting();
+    void NotifyOne(std::condition_variable &condition) override;
+    void NotifyAll(std::condition_variable &condition) override;
+
+protected:
+    uint64_t BeginWait(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, time_point deadline) override;
+    void EndWait(uint64_t id) override;
+    void Wait(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, time_point deadline) override;
+
+private:
+    struct Waiter {
+        uint64_t id; // Several threads may wait on one condition
+        std::condition_variable *condition;
+        std::mutex *mutex;
+        std::thread::id thread;
+        time_point deadline;
+    };
+
+    void AdvanceLocked(std::unique_lock<std::mutex> &lock, time_point target);
+    Waiter* FindWaiter(uint64_t id);
+    void SetRunning(std::thread::id thread, bool running);
+
+    std::atomic<rep> m_now;
+    std::mutex m_mutex; // Protects everything below. Waiters take it with their own mutex held, never the reverse
+    std::vector<Waiter> m_waiters;
+    uint64_t m_nextWaiter = 0;
+    std::vector<std::thread::id> m_running; // Woken and not blocked in a wait again yet
+    std::condition_variable m_settledCondition;
+    std::condition_variable m_sleepCondition; // Sleepers wait here
+    std::mutex m_sleepMutex;
+};
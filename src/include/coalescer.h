@@ -0,0 +1,62 @@
+#pragma once
+#include <interface.h>
+#include <standard.h>
+#include <atomic>
+#include <chrono>
+#include <clock.h>
+#include <functional>
+#include <stdio.h>
+
+// Merges fader, master and dial input into at most one update per control per frame.
+// Faders and the master are latest-wins with a dead-band, dial deltas are summed.
+// The first movement after a quiet frame is emitted straight away, so coalescing only
+// adds latency to controls that are already moving.
+class InputCoalescer {
+public:
+    using clock = Clock;
+    using time_point = std::chrono::time_point<clock>;
+
+    struct Config {
+        uint32_t frameInterval = 10; // ms, minimum time between two updates of the same control
+        uint32_t faderDeadband = 16; // Raw fader units (of 16380), smaller moves wait until the fader settles
+    };
+
+    InputCoalescer(Config config);
+    // Returns false for events that are not coalesced, those should be handled immediately
+    bool Absorb(const PhysicalEvent &event, time_point now);
+    // Emits every control whose frame is due, or every pending control when `force` is set
+    void Flush(time_point now, const std::function<void(const PhysicalEvent&)> &emit, bool force = false);
+    // Next time Flush has work to do, time_point::max() when nothing is pending
+    time_point Deadline();
+    // Safe to call from any thread
+    void Report(FILE *out);
+
+private:
+    static constexpr uint32_t FADER_COUNT = PHYSICAL_CHANNEL_COUNT + 1; // Channel faders, then the master
+
+    struct Control {
+        bool pending = false;
+        int value = 0; // Fader level, or summed dial delta
+        int emitted = -1; // Last fader level emitted, -1 before the first
+        time_point lastInput;
+        time_point due;
+        time_point origin; // Latency tracing origin of the oldest input waiting
+    };
+    struct Counter {
+        std::atomic<uint64_t> in{0};
+        std::atomic<uint64_t> out{0};
+    };
+
+    bool FaderReady(Control &control, time_point now, bool force);
+    void Report(FILE *out, const char *name, Counter &counter);
+
+    const Config m_config;
+    const clock::duration m_frame;
+    Control m_faders[FADER_COUNT];
+    Control m_dials[PHYSICAL_CHANNEL_COUNT];
+    time_point m_lastEmit[FADER_COUNT + PHYSICAL_CHANNEL_COUNT];
+
+    Counter m_faderCounter;
+    Counter m_masterCounter;
+    Counter m_dialCounter;
+};
@@ -4,43 +4,60 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
+#include <stdint.h>
+#include <clock.h>
 
 using RegistrationId = uint32_t;
 
+// Runs a registered callback once its value has stopped changing for the registration's delay.
+// Deadlines are kept in a min-heap and the thread sleeps until the earliest one, callbacks run
+// on that thread without any lock held, so they may call back into the executer.
+// Pushing a pending deadline later does not touch the heap, its entry is moved when it comes up.
 class DelayedExecuter {
 private:
-    using clock = std::chrono::high_resolution_clock;
-    using time_point = std::chrono::time_point<clock>;
+    using clock = Clock;
+    using time_point = clock::time_point;
 
-    struct Execution {
-        RegistrationId id;
-        bool active;
-        float value;
-        time_point lastTime;
+    struct Registration {
+        std::function<void(float)> callback; // Empty when the slot is free
         uint32_t delayDuration;
-        std::function<void(float)> callback;
+        float value;
+        time_point deadline; // Valid while pending, may be later than its heap entry
+        uint32_t generation = 0; // Bumped whenever the pending deadline is dropped
+        bool pending = false;
+    };
+    struct Deadline {
+        time_point when;
+        RegistrationId id;
+        uint32_t generation; // Stale when it no longer matches the registration, skipped when it comes up
+    };
+    struct Later {
+        bool operator()(const Deadline &a, const Deadline &b) const { return a.when > b.when; }
     };
-    // Used to protect m_delayedExecutions
-    std::mutex m_mutex_data;
-    std::vector<Execution> m_delayedExecutions;
 
+    std::mutex m_mutex; // Protects everything below
+    std::condition_variable m_condition; // Signalled when a deadline earlier than the current first is added
+    std::vector<Registration> m_registrations;
+    std::vector<RegistrationId> m_free; // Unregistered slots, reused by Register
+    std::vector<Deadline> m_deadlines; // Min-heap on `when`
     std::thread m_thread;
-    // Used to block thread when no executions are active 
-    std::mutex m_mutex_note; 
-    // Used to wake up thread when new execution is added based on m_mutex_note
-    std::condition_variable m_condition;
-    bool m_suspended = false;
+
     void _threadimpl();
-    void _wait();
-    // Wake up thread, if thread is suspended
-    void _maybe_wake(); 
+    void _schedule(RegistrationId id, time_point when);
+    void _push(RegistrationId id, time_point when);
 
 public:
     DelayedExecuter();
     RegistrationId Register(std::function<void(float)> callback, uint32_t delayDuration);
+    // The id may be reused by a later Register. A callback that is already running still finishes.
+    void Unregister(RegistrationId id);
+    // Restarts the delay when the value has changed
     void Update(RegistrationId id, float value);
     // Immediately execute the callback of a delayed execution
     void ForcedUpdate(RegistrationId id, float value);
+    // Drops the pending execution, if any
+    void Cancel(RegistrationId id);
 };
 
-extern DelayedExecuter *g_delayedThreadScheduler;
\ No newline at end of file
+extern DelayedExecuter *g_delayedThreadScheduler;
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free latency histogram in microseconds. Buckets are log-linear
+// (8 buckets per power of two), so percentiles are accurate to ~12%.
+// Record may be called from any thread, readers see a relaxed snapshot.
+class LatencyHistogram {
+public:
+    void Record(uint64_t micros);
+    void Reset();
+
+    uint64_t Count();
+    uint64_t Max();
+    // Upper bound of the bucket containing the given percentile (0-100)
+    uint64_t Percentile(double percentile);
+
+private:
+    static constexpr uint32_t SUB_BUCKET_BITS = 3;
+    static constexpr uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr uint32_t BUCKET_COUNT = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    static uint32_t BucketIndex(uint64_t micros);
+    static uint64_t BucketUpperBound(uint32_t index);
+
+    std::atomic<uint64_t> m_buckets[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_max{0};
+};
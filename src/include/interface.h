@@ -1,5 +1,9 @@
 #pragma once
 #include <list>
+#include <vector>
+#include <bitset>
+#include <initializer_list>
+#include <assert.h>
 #include <x-touch.h>
 
 namespace StructImpl {
@@ -31,6 +35,12 @@ namespace StructImpl {
         int value;
     };
 
+    struct FaderTouch 
+    {
+        uint16_t Column; // 0-7 channel faders, 8 master
+        int touched;
+    };
+
     union InterfaceData 
     {
         // Fader, dial, dial press
@@ -40,6 +50,7 @@ namespace StructImpl {
         Button button;
         Master master;
         Jog jog;
+        FaderTouch faderTouch;
     };
 
 }
@@ -54,8 +65,12 @@ enum class PhysicalEventType {
 
     MASTER,
 
-    JOG
+    JOG,
+
+    FADER_TOUCH
 };
+constexpr uint32_t PHYSICAL_EVENT_TYPE_COUNT = static_cast<uint32_t>(PhysicalEventType::FADER_TOUCH) + 1;
+constexpr uint32_t BUTTON_ROUTE_COUNT = 128; // Button ids are 7 bit note numbers
 
 enum class FaderButtonType {
     REC, SOLO, MUTE, SELECT
@@ -67,11 +82,73 @@ struct PhysicalEvent
     StructImpl::InterfaceData data;
 };
 
+// Events a layer consumes. System buttons are routed per id, every other event per type.
+struct InputRoutes {
+    std::bitset<PHYSICAL_EVENT_TYPE_COUNT> types;
+    std::bitset<BUTTON_ROUTE_COUNT> buttons;
+
+    void Add(PhysicalEventType type) {
+        if (type == PhysicalEventType::BUTTON) { buttons.set(); return; }
+        types.set(static_cast<uint32_t>(type));
+    }
+    void AddButton(uint32_t id) {
+        assert(id < BUTTON_ROUTE_COUNT);
+        buttons.set(id);
+    }
+    void AddButtons(std::initializer_list<uint32_t> ids) {
+        for(auto id : ids) { AddButton(id); }
+    }
+    void AddAll() {
+        types.set();
+        buttons.set();
+    }
+};
+
+// LEDs a layer wants lit. The InterfaceManager composites the scenes of the layer stack, top layer
+// first, and only LEDs whose composited state changed are sent to the X-Touch.
+class LedScene {
+public:
+    void Set(uint32_t button, xt_button_state_t state) {
+        assert(button < BUTTON_ROUTE_COUNT);
+        if (m_set.test(button) && m_states[button] == state) { return; }
+        m_set.set(button);
+        m_states[button] = state;
+        m_changed = true;
+    }
+    // Leaves `button` to the layers below
+    void Release(uint32_t button) {
+        assert(button < BUTTON_ROUTE_COUNT);
+        if (!m_set.test(button)) { return; }
+        m_set.reset(button);
+        m_changed = true;
+    }
+    // An opaque scene turns off every LED it does not set, hiding the scenes below it
+    void SetOpaque(bool opaque) {
+        if (m_opaque == opaque) { return; }
+        m_opaque = opaque;
+        m_changed = true;
+    }
+
+private:
+    friend class InterfaceManager;
+    bool Covers(uint32_t button) const { return m_opaque || m_set.test(button); }
+    xt_button_state_t State(uint32_t button) const { return m_set.test(button) ? m_states[button] : OFF; }
+
+    std::bitset<BUTTON_ROUTE_COUNT> m_set;
+    xt_button_state_t m_states[BUTTON_ROUTE_COUNT] = {};
+    bool m_opaque = false;
+    bool m_changed = false;
+};
+
 struct InterfaceLayer {
+    LedScene m_lights;
     virtual void Resume() = 0;
     virtual void Pause() = 0;
     virtual void Start() = 0;
     virtual void Removed() = 0;
+    // Called whenever the layer stack changes, HandleInput only receives the events declared here.
+    // A layer can still return false to pass an event on to the next layer below that declared it.
+    virtual void DeclareRoutes(InputRoutes &routes) { routes.AddAll(); }
     virtual bool HandleInput(PhysicalEvent event) = 0;
 };
 
@@ -79,13 +156,24 @@ class InterfaceManager {
 public:
     void PushLayer(InterfaceLayer *layer);
     void PopLayer();
+    // Sends the LEDs whose composited state changed since the last call
+    void FlushLights();
     InterfaceManager(XTouch *xtouch);
 private:
     void ReceiveDial(unsigned char, int);
     void ReceiveFader(unsigned char, int);
     void ReceiveButton(unsigned char, int);
+    void ReceiveFaderTouch(unsigned char, int);
     void DispatchEvent(PhysicalEvent event);
+    void RebuildRoutes();
+    static uint32_t RouteIndex(const PhysicalEvent &event);
+
+    static constexpr uint32_t ROUTE_COUNT = PHYSICAL_EVENT_TYPE_COUNT + BUTTON_ROUTE_COUNT;
+    XTouch *m_xtouch;
     std::list<InterfaceLayer*> m_layers;
+    bool m_stackChanged = true; // The scenes to composite changed
+    // For every event type and button id, the layers that declared it, top of the stack first
+    std::vector<InterfaceLayer*> m_routes[ROUTE_COUNT];
 };
 
 extern InterfaceManager *g_interfaceManager;
\ No newline at end of file
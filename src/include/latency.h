@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <clock.h>
+#include <histogram.h>
+
+// Points along the two paths through the controller. Each is measured from the arrival of the datagram
+// that caused it, an X-Touch packet for the XT_ stages and an MA response for the MA_ stages.
+enum class LatencyStage : uint32_t {
+    XT_HANDLE_PACKET, // Received by TCPServer::Read -> XTouch::HandlePacket, includes the mailbox wait
+    XT_DISPATCH, // -> InterfaceManager::DispatchEvent
+    XT_HANDLED, // -> the owning layer's handler returned
+    XT_MA_SEND, // -> the resulting packet sent by MaUDPServer::Send, after any coalescing
+    MA_APPLY, // Received by MaUDPServer -> ApplyRefresh on the controller thread
+    MA_XT_SEND, // -> the X-Touch packets carrying the change sent
+    COUNT
+};
+
+// Optional per stage latency histograms, g_latency is null unless XCTL_LATENCY_TRACE is set.
+// The origin is per thread: whoever handles a datagram sets it to the datagram's arrival time,
+// and every Mark on that thread is measured from it. Marks are lock-free, Dump may run on any thread.
+class LatencyTracer {
+public:
+    using time_point = Clock::time_point;
+
+    static void SetOrigin(time_point origin) { s_origin = origin; }
+    static void ClearOrigin() { s_origin = time_point(); }
+    // time_point() when the calling thread is not handling a datagram
+    static time_point Origin() { return s_origin; }
+
+    // Records the time since the calling thread's origin, if it has one
+    void Mark(LatencyStage stage);
+    void Record(LatencyStage stage, time_point origin);
+    void Dump(FILE *out);
+
+private:
+    static const char* Name(LatencyStage stage);
+
+    inline static thread_local time_point s_origin;
+    LatencyHistogram m_stages[static_cast<uint32_t>(LatencyStage::COUNT)];
+};
+
+extern LatencyTracer *g_latency;
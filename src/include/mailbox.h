@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <clock.h>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+enum class CommandType : uint32_t {
+    XT_PACKET, // Raw packet received from the X-Touch
+    MA_RESPONSE, // Playback refresh response, `version` is the address snapshot it was requested for
+};
+
+struct Command {
+    static constexpr uint32_t MAX_SIZE = 4096;
+
+    CommandType type;
+    uint32_t size;
+    uint64_t version;
+    Clock::time_point origin; // Arrival of the datagram, only set while latency tracing
+    char data[MAX_SIZE];
+};
+
+// Bounded, lock-free, multi producer / single consumer command queue.
+// The controller thread owns XTouch, ChannelGroup and InterfaceManager. Every other thread
+// hands work to it through Post, only the controller thread may call Consume and Wait.
+class Mailbox {
+public:
+    using clock = Clock;
+    static constexpr uint64_t CAPACITY = 256; // Must be a power of two
+
+    Mailbox();
+    ~Mailbox();
+    // Copies the payload into the queue. Returns false when the queue is full or the payload does not fit
+    bool Post(CommandType type, const void *data, uint32_t size, uint64_t version = 0, Clock::time_point origin = Clock::time_point());
+    // Runs `handler` on the oldest command in place, returns false when the queue is empty
+    template<typename F> bool Consume(F &&handler);
+    // Blocks until a command is posted or `deadline` passes
+    void Wait(clock::time_point deadline);
+    uint64_t Dropped();
+    // Commands posted but not yet consumed, only the consumer may ask
+    uint64_t Depth() { return m_tail.load(std::memory_order_relaxed) - m_head; }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> sequence;
+        Command command;
+    };
+
+    bool Empty();
+
+    Cell *m_cells;
+    alignas(64) std::atomic<uint64_t> m_tail{0}; // Next position to be claimed by a producer
+    alignas(64) uint64_t m_head = 0; // Next position to be consumed, only touched by the consumer
+    std::atomic<uint64_t> m_dropped{0};
+
+    // Used to park the consumer when there is nothing to do
+    std::atomic<bool> m_sleeping{false};
+    std::mutex m_mutex_wake;
+    std::condition_variable m_condition;
+    bool m_woken = false;
+};
+
+template<typename F>
+bool Mailbox::Consume(F &&handler) {
+    Cell &cell = m_cells[m_head & (CAPACITY - 1)];
+    if (cell.sequence.load(std::memory_order_acquire) != m_head + 1) { return false; }
+
+    handler(cell.command);
+    // Hand the cell back to producers for the next lap around the ring
+    cell.sequence.store(m_head + CAPACITY, std::memory_order_release);
+    m_head++;
+    return true;
+}
+
+extern Mailbox *g_mailbox;
@@ -2,20 +2,56 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <functional>
+#include <chrono>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 #include <IPC.h>
+#include <rtt.h>
+#include <clock.h>
 
 class MaUDPServer {
 private:
+    static constexpr uint32_t PACKET_SIZE = 4096;
+    static constexpr uint32_t QUEUE_SIZE = 4; // Responses waiting to be Read
+
     int m_sockfd;
     struct sockaddr_in m_server_addr;
+    std::atomic<uint32_t> m_nextSeq{1};
+    RoundTripTracker m_roundTrip;
+
+    // Packets received that are not ACKs, handed to Read
+    struct Packet {
+        ssize_t size;
+        Clock::time_point arrived; // Only set while latency tracing
+        char data[PACKET_SIZE];
+    };
+    std::mutex m_mutex_queue;
+    std::condition_variable m_queueCondition;
+    Packet m_queue[QUEUE_SIZE];
+    uint32_t m_queueHead = 0;
+    uint32_t m_queueCount = 0;
+    std::thread m_recv_thread;
+    std::atomic<bool> m_ready{false}; // The plugin has sent something, set under m_mutex_queue
+    std::condition_variable m_readyCondition;
 
     ssize_t _sendimpl(const void *buf, size_t len);
     ssize_t _recvimpl(void *buf, size_t len);
+    void _recvthread();
 
 public:
     MaUDPServer();
-    ssize_t Send(char *data, uint32_t size);
-    ssize_t Read(char *data, uint32_t size);
+    // Stamps the next sequence number into the packet header before sending.
+    // The assigned sequence is written to `seq` when provided.
+    ssize_t Send(char *data, uint32_t size, uint32_t *seq = nullptr);
+    // Waits up to one second for the next response that is not an ACK.
+    // When latency tracing, `arrived` receives the time it was received.
+    ssize_t Read(char *data, uint32_t size, Clock::time_point *arrived = nullptr);
+    // Sends a HELLO unless the plugin has already been heard from, then waits up to `timeout` for it to answer.
+    // Returns whether the plugin is listening.
+    bool Handshake(std::chrono::milliseconds timeout);
     void SendSystemButton(IPC::ButtonEvent::KeyType type, bool down);
-};
\ No newline at end of file
+    void ReportLatency(FILE *out);
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <thread>
+
+// Everything the controller counts. Counters only go up, gauges hold the last value set.
+enum class Metric : uint32_t {
+    XT_DATAGRAMS_IN,
+    XT_DATAGRAMS_OUT,
+    MA_DATAGRAMS_IN,
+    MA_DATAGRAMS_OUT,
+    // Bytes sent to the X-Touch, by what they carry
+    XT_BYTES_LED,
+    XT_BYTES_FADER,
+    XT_BYTES_DIAL,
+    XT_BYTES_SCRIBBLE,
+    XT_BYTES_METER,
+    XT_BYTES_SEGMENT,
+    XT_BYTES_OTHER, // Probe response and idle keep-alive
+    XT_PACKETS_DROPPED, // Mailbox full
+    MA_TIMEOUTS, // Refresh requests without a response
+    MA_SEQ_MISMATCHES, // Responses to an earlier request, skipped or rejected
+    MA_STALE_RESPONSES, // Responses for channels the surface has navigated away from
+    MA_RESPONSES_DROPPED, // Receive queue or mailbox full
+    // Gauges
+    MAILBOX_DEPTH, // Commands waiting when the controller thread wakes
+    MA_QUEUE_DEPTH, // Responses waiting for the refresh thread
+    LOOP_UTILISATION, // Permille of the last second the controller thread spent working
+    COUNT
+};
+
+// Relaxed atomic counters and gauges, cheap enough to update from any hot path.
+// Serve answers every connection on a Unix domain socket with a text snapshot in the
+// Prometheus exposition format and closes it, eg `socat - UNIX-CONNECT:/tmp/xctl-10111-metrics.sock`.
+class Metrics {
+public:
+    Metrics() = default;
+    ~Metrics();
+
+    void Add(Metric metric, uint64_t amount = 1) {
+        m_values[static_cast<uint32_t>(metric)].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+    void Set(Metric metric, uint64_t value) {
+        m_values[static_cast<uint32_t>(metric)].value.store(value, std::memory_order_relaxed);
+    }
+    uint64_t Get(Metric metric) const {
+        return m_values[static_cast<uint32_t>(metric)].value.load(std::memory_order_relaxed);
+    }
+
+    // Writes the snapshot into `buffer`, returns its length
+    size_t Snapshot(char *buffer, size_t size) const;
+    // Binds `path`, replacing a socket left behind by an earlier run, and serves it from a thread.
+    // Returns false, after printing why, when another process still serves `path` or it can not be bound.
+    bool Serve(const char *path);
+
+private:
+    struct Descriptor {
+        const char *name;
+        bool gauge;
+        const char *help;
+    };
+    static const Descriptor DESCRIPTORS[];
+
+    void Accept();
+
+    // Own cache line each, the reader threads and the controller thread update them concurrently
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+    Slot m_values[static_cast<uint32_t>(Metric::COUNT)];
+    int m_socket = -1;
+    std::thread m_thread;
+};
+
+extern Metrics *g_metrics;
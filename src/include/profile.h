@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <interface.h>
+#include <IPC.h>
+
+enum class ButtonActionType : uint8_t {
+    NONE,
+    MA_KEY, // value is an IPC::ButtonEvent::KeyType
+    SCROLL, // value is -1 or 1, moves the executor window
+    PAGE, // value is -1 or 1, changes page
+    PIN_MODE // Enters and leaves pin configuration
+};
+
+struct ButtonAction {
+    ButtonActionType type = ButtonActionType::NONE;
+    int32_t value = 0;
+};
+bool operator==(const ButtonAction& a, const ButtonAction& b);
+
+namespace ButtonActions {
+    constexpr ButtonAction SCROLL_LEFT = { ButtonActionType::SCROLL, -1 };
+    constexpr ButtonAction SCROLL_RIGHT = { ButtonActionType::SCROLL, 1 };
+    constexpr ButtonAction PAGE_DEC = { ButtonActionType::PAGE, -1 };
+    constexpr ButtonAction PAGE_INC = { ButtonActionType::PAGE, 1 };
+    constexpr ButtonAction PIN_MODE = { ButtonActionType::PIN_MODE, 0 };
+}
+
+// Maps every system button to the action it performs, indexed by xt_buttons.
+// The default layout matches the labels on our overlay, a venue can replace it with a profile file:
+//
+//   # button           action   argument
+//   SCRUB              ma       CLEAR
+//   FADER_BANK_LEFT    scroll   -1
+//   CHANNEL_RIGHT      page     1
+//   FLIP               pin
+//
+// Buttons are given by their xt_buttons name or note number. A profile lists the whole layout,
+// buttons it does not mention do nothing.
+class ButtonProfile {
+public:
+    ButtonProfile();
+    // Replaces the layout with the one in `path`. On error the current layout is kept, the error is printed and false returned
+    bool Load(const char *path);
+
+    const ButtonAction& Action(uint32_t button) const {
+        assert(button < BUTTON_ROUTE_COUNT);
+        return m_actions[button];
+    }
+    bool IsBound(uint32_t button, ButtonActionType type) const {
+        return button < BUTTON_ROUTE_COUNT && m_actions[button].type == type;
+    }
+    // Routes every button bound to an action of `type`
+    void AddRoutes(InputRoutes &routes, ButtonActionType type) const;
+    // Calls `fn` with every button bound to `action`
+    template<typename Fn>
+    void ForEachButton(ButtonAction action, Fn fn) const {
+        for(uint32_t i = 0; i < BUTTON_ROUTE_COUNT; i++) {
+            if (m_actions[i] == action) { fn(i); }
+        }
+    }
+
+private:
+    ButtonAction m_actions[BUTTON_ROUTE_COUNT];
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#include <clock.h>
+#include <mutex>
+#include <atomic>
+#include <IPC.h>
+#include <histogram.h>
+
+// Matches the sequence numbers echoed by the plugin against the packets we sent
+// and keeps per packet type round trip histograms and loss/ordering counters.
+class RoundTripTracker {
+public:
+    RoundTripTracker();
+    void Sent(IPC::PacketType::Type type, uint32_t seq);
+    // `type` is the type of the packet being acknowledged, not of the echo itself
+    void Received(IPC::PacketType::Type type, uint32_t seq);
+    void Report(FILE *out);
+
+    struct Stats {
+        LatencyHistogram rtt;
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> echoed{0};
+        std::atomic<uint64_t> lost{0}; // No echo within LOSS_TIMEOUT_MS
+        std::atomic<uint64_t> late{0}; // Echo arrived after being counted as lost
+        std::atomic<uint64_t> outOfOrder{0}; // Echo seq lower than an echo already seen
+    };
+    Stats &StatsFor(IPC::PacketType::Type type);
+
+private:
+    using clock = Clock;
+    using time_point = std::chrono::time_point<clock>;
+
+    static constexpr uint32_t WINDOW = 1024; // Packets tracked in flight, indexed by seq % WINDOW
+    static constexpr uint32_t LOSS_TIMEOUT_MS = 1000;
+    static constexpr uint32_t TYPE_COUNT = IPC::PacketType::END - IPC::PacketType::REQ_ENCODERS;
+
+    enum class SlotState : uint8_t { EMPTY, IN_FLIGHT, ECHOED, EXPIRED };
+    struct Slot {
+        uint32_t seq;
+        IPC::PacketType::Type type;
+        SlotState state;
+        time_point sentAt;
+    };
+
+    void Expire(time_point now);
+
+    std::mutex m_mutex; // Protects m_slots and m_highestEcho
+    Slot m_slots[WINDOW];
+    uint32_t m_highestEcho = 0;
+    Stats m_stats[TYPE_COUNT];
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <clock.h>
+#include <mutex>
+#include <condition_variable>
+
+// Paces the playback refresh loop. Polls quickly while the operator is using the
+// surface or MA values are changing, decays towards an idle rate when nothing changes,
+// and backs off exponentially while the plugin is not answering.
+class RefreshScheduler {
+public:
+    struct Config {
+        uint32_t activeInterval = 25; // ms between polls while values are changing
+        uint32_t idleInterval = 500; // ms between polls once the desk is idle
+        uint32_t idleAfter = 2000; // ms without any change before the rate starts decaying
+        uint32_t failureInterval = 100; // ms to wait after the first failed poll, doubled per failure
+        uint32_t maxFailureInterval = 5000; // ms, upper bound for the failure backoff
+    };
+    enum class Mode { ACTIVE, IDLE, BACKOFF };
+
+    RefreshScheduler(Config config);
+    // Operator interaction, returns the loop to the active rate and wakes it if sleeping
+    void NoteActivity();
+    // Result of a single poll, `changed` is true when the response differed from the last one
+    void NoteResult(bool success, bool changed);
+    // Sleeps for the current interval, returning early if NoteActivity is called
+    void Wait();
+
+    uint32_t CurrentInterval();
+    float CurrentRate(); // Polls per second
+    Mode CurrentMode();
+
+private:
+    using clock = Clock;
+    using time_point = std::chrono::time_point<clock>;
+
+    void SetMode(Mode mode);
+
+    const Config m_config;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_woken = false;
+
+    Mode m_mode = Mode::ACTIVE;
+    uint32_t m_interval;
+    uint32_t m_failures = 0;
+    time_point m_lastChange;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <type_traits>
+
+// Single writer, multiple reader sequence lock.
+// The writer never blocks, readers retry until they copy out a value that was not being written concurrently.
+// The payload is stored as atomic words so a torn read is detected rather than being a data race.
+template<typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock payload must be trivially copyable");
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> m_sequence {0}; // Odd while a write is in progress
+    std::atomic<uint64_t> m_words[WORDS] {};
+public:
+    // Must only be called from one thread at a time. Returns the version of the published value
+    uint64_t Publish(const T &value) {
+        uint64_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for(size_t i = 0; i < WORDS; i++) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_sequence.store(sequence + 2, std::memory_order_release);
+        return (sequence + 2) / 2;
+    }
+
+    // Copies the latest value into `out` and returns its version
+    uint64_t Read(T &out) const {
+        uint64_t words[WORDS];
+        while(true) {
+            uint64_t before = m_sequence.load(std::memory_order_acquire);
+            if (before & 1) { std::this_thread::yield(); continue; }
+
+            for(size_t i = 0; i < WORDS; i++) {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == before) {
+                memcpy(&out, words, sizeof(T));
+                return before / 2;
+            }
+        }
+    }
+
+    // Version of the most recently completed Publish
+    uint64_t Version() const {
+        return m_sequence.load(std::memory_order_acquire) / 2;
+    }
+};
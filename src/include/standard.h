@@ -3,8 +3,19 @@
 
 constexpr unsigned short xt_port = 10111;
 constexpr unsigned int PHYSICAL_CHANNEL_COUNT = 8;
-// constexpr unsigned int MAX_PAGE_COUNT = 9999;
-constexpr unsigned int MAX_PAGE_COUNT = 99; // TODO: Limiting to 99 as the assignment display only has 2 digits. Do we really need 9999 pages?
-constexpr unsigned int MAX_CHANNEL_COUNT = 90;
+// Defaults for ChannelGroupConfig, pages past 99 are shown across the assignment and bars digits
+constexpr unsigned int DEFAULT_PAGE_COUNT = 99;
+constexpr unsigned int DEFAULT_CHANNEL_COUNT = 90;
+// Upper bounds of what MA3 can address, executors are addressed as channel + row * 100
+constexpr unsigned int MAX_PAGE_COUNT = 9999;
+constexpr unsigned int MAX_CHANNEL_COUNT = 99;
+constexpr unsigned int RTT_REPORT_INTERVAL = 30; // Seconds between MA round trip reports
+constexpr unsigned int METER_REFRESH_INTERVAL = 100; // Milliseconds, the X-Touch meters decay unless resent
+constexpr unsigned int JOG_SETTLE_INTERVAL = 150; // Milliseconds the jog wheel must rest before its target is shown
+constexpr unsigned int NAVIGATION_SETTLE_INTERVAL = 120; // Same for page and scroll presses, a double or triple tap is applied as one
+constexpr const char *DEFAULT_STATE_FILE = "/tmp/xctl-%u.state"; // Warm start state per X-Touch port, XCTL_STATE_FILE overrides it, empty disables it
+constexpr const char *DEFAULT_METRICS_SOCKET = "/tmp/xctl-%u-metrics.sock"; // Per X-Touch port, XCTL_METRICS_SOCKET overrides it, empty disables it
+constexpr unsigned int HELLO_RETRY_INTERVAL = 100; // Milliseconds between startup hellos while the plugin is not answering
+constexpr unsigned int MAILBOX_BATCH_SIZE = 64; // Commands handled per controller loop iteration before flushing
 enum class ControlType { UNKNOWN, SEGMENT, FADER, KNOB };
 enum class SegmentID { UNKNOWN, PAGE };
\ No newline at end of file
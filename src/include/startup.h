@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <clock.h>
+
+// Times the startup phases from process start. Each phase is logged the first time it is reached,
+// from whichever thread reaches it, and the surface is reported usable once it is connected and showing MA data.
+class StartupTimer {
+public:
+    enum Phase : uint32_t {
+        SERVERS_BOUND, // X-Touch and MA sockets are open
+        GROUP_READY, // Layers and channels exist, warm state is painted
+        XTOUCH_CONNECTED, // Probe answered
+        PLUGIN_READY, // Plugin answered the hello
+        FIRST_REFRESH, // First MA refresh applied to the surface
+        PHASE_COUNT
+    };
+
+    StartupTimer();
+    // Only the first call for a phase counts
+    void Mark(Phase phase);
+    bool Reached(Phase phase) const;
+
+private:
+    static const char* Name(Phase phase);
+
+    Clock::time_point m_start;
+    std::atomic<int64_t> m_elapsed[PHASE_COUNT]; // Microseconds after m_start, -1 until reached
+    std::atomic<bool> m_usableLogged{false};
+};
+
+extern StartupTimer *g_startup;
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+#include <clock.h>
+
+// Optional timeline of what every thread is doing, written as Chrome trace event JSON for
+// chrome://tracing or ui.perfetto.dev. g_trace is null unless XCTL_TRACE_FILE is set.
+// Each thread appends to its own buffer without locking, the buffer is allocated on the thread's
+// first event. A full buffer stops recording for that thread, Write may run on any thread.
+class Tracer {
+public:
+    static constexpr uint32_t EVENTS_PER_THREAD = 1 << 17;
+
+    Tracer() : m_start(Clock::now()) {}
+    // Names the calling thread in the trace. Safe to call before tracing is enabled
+    static void NameThread(const char *name) { s_threadName = name; }
+
+    // `name` must be a string literal, only the pointer is kept
+    void Begin(const char *name) { Record(name, 'B'); }
+    void End(const char *name) { Record(name, 'E'); }
+    void Instant(const char *name) { Record(name, 'i'); }
+    // Writes everything recorded so far to `path`. Returns false, after printing why, when it can not be written
+    bool Write(const char *path);
+
+private:
+    struct Event {
+        const char *name;
+        int64_t time; // Nanoseconds since the tracer was created
+        char phase;
+    };
+    struct Buffer {
+        const char *threadName;
+        uint32_t tid;
+        std::atomic<uint32_t> count{0}; // Events before this are complete and never change
+        Event events[EVENTS_PER_THREAD];
+    };
+
+    void Record(const char *name, char phase);
+    Buffer* CreateBuffer();
+
+    inline static thread_local const char *s_threadName = nullptr;
+    inline static thread_local Buffer *s_buffer = nullptr;
+    Clock::time_point m_start;
+    std::mutex m_mutex_buffers;
+    std::vector<std::unique_ptr<Buffer>> m_buffers; // Never shrinks, a thread may exit while its events are still wanted
+    std::atomic<uint64_t> m_dropped{0};
+};
+
+extern Tracer *g_trace;
+
+// Records a span around its scope when tracing is enabled
+class TraceSpan {
+public:
+    explicit TraceSpan(const char *name) : m_name(g_trace ? name : nullptr) {
+        if (m_name) { g_trace->Begin(m_name); }
+    }
+    ~TraceSpan() {
+        if (m_name) { g_trace->End(m_name); }
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char *m_name;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <standard.h>
+#include <Address.h>
+#include <IPC.h>
+
+// Surface state kept in a small memory mapped file, so a restarted controller can paint the
+// last known page, pins, names and values in its first frame and let the live refresh reconcile.
+// Every Store writes straight into the mapping, the kernel writes it back whenever it likes;
+// the file only has to survive the process, not the machine. The file is locked while mapped,
+// a second controller pointed at it starts cold instead of sharing the mapping.
+class WarmState {
+public:
+    enum class ChannelState : uint8_t { UNKNOWN, INACTIVE, ACTIVE };
+    struct Channel {
+        Address address;
+        uint8_t pinned;
+        ChannelState state;
+        IPC::PlaybackRefresh::Data data; // Last refresh of `address`, valid when state is ACTIVE
+    };
+    struct File {
+        uint32_t magic;
+        uint32_t size; // sizeof(File), catches layout changes between builds
+        uint32_t pageCount; // Configuration the state was saved with, it is discarded if this differs
+        uint32_t channelCount;
+        uint32_t page;
+        uint32_t channelOffset;
+        float master;
+        uint8_t masterValid;
+        Channel channels[PHYSICAL_CHANNEL_COUNT];
+    };
+
+    WarmState() = default;
+    ~WarmState();
+    // Maps `path`, creating it if needed. Returns true when it held state saved with the same
+    // configuration. Without a usable file, or when another process holds it, the state is kept
+    // in memory and nothing is restored.
+    bool Open(const char *path, uint32_t pageCount, uint32_t channelCount);
+    const File& Get() const { return *m_file; }
+
+    void StoreLayout(uint32_t page, uint32_t channelOffset, const Address (&addresses)[PHYSICAL_CHANNEL_COUNT], const bool (&pinned)[PHYSICAL_CHANNEL_COUNT]);
+    // `data` may be null for a channel without an executor
+    void StoreChannel(uint32_t channel, const IPC::PlaybackRefresh::Data *data);
+    void StoreMaster(float value);
+
+private:
+    void Reset(uint32_t pageCount, uint32_t channelCount);
+
+    static constexpr uint32_t MAGIC = 0x58435753; // "XCWS"
+    File m_memory; // Used when there is no file
+    File *m_file = &m_memory;
+    bool m_mapped = false;
+    int m_fd = -1; // Kept open for the lock
+};
@@ -195,6 +195,7 @@ typedef struct {
     xt_colours_t Colour;
     int Inverted;
 } xt_ScribblePad_t;
+bool operator==(const xt_ScribblePad_t& a, const xt_ScribblePad_t& b);
 
 namespace ButtonUtils {
     enum class ButtonType : uint16_t {
@@ -212,7 +213,6 @@ namespace ButtonUtils {
     int MuteButtonToChannel(xt_buttons button);
     int SelectButtonToChannel(xt_buttons button);
     ButtonInfo FaderButtonToButtonType(xt_buttons button);
-    bool AddressChangingButton(xt_buttons button);
 }
 
 class XTouch {
@@ -222,19 +222,28 @@ class XTouch {
 
         int HandlePacket(unsigned char *buffer, unsigned int len);
         void SetAssignment(int v);
+        void SetAssignmentWide(int v);
         void SetHMSF(int h, int m, int s, int f);
         void SetFrames(int v);
         void SetTime(struct tm* t);
         void SetDialPan(int channel, int position);
         void SetDialLevel(int channel, int level);
+        void SetDial(int channel, int value);
         void SetFaderLevel(int channel, int level);
         void SetMeterLevel(int channel, int level);
         void SetSingleButton(unsigned char n, xt_button_state_t v);
         void SetScribble(int channel, xt_ScribblePad_t info);
         void RegisterPacketSender(PacketCallback handler);     
+        // Called once, when the first probe has been answered
+        void RegisterConnectCallback(std::function<void()> handler);
         void ClearButtonLights();
-        void PushLightState(bool reset);
-        void PopLightState();
+        void Flush();
+        void SendAllMeters();
+        // Minimum real time between two packets to the surface, zero sends them back to back
+        void SetPacketGap(std::chrono::microseconds gap) { m_packetGap = gap; }
+
+        // Roughly what the unoptimised busy loop that used to pace SendPacket took
+        static constexpr std::chrono::microseconds DEFAULT_PACKET_GAP{100};
 
     private:
         friend class InterfaceManager;
@@ -257,6 +266,7 @@ class XTouch {
         void SendSingleButton(unsigned char n);
         void SendAllButtons();
         void SendSingleDial(unsigned char n, int value);
+        void SendAllDials();
         void SendSingleFader(unsigned char n);
         void SendAllFaders();
         void SendAllBoard();
@@ -264,28 +274,34 @@ class XTouch {
         void SendSegments();
         void DisplayNumber(unsigned char start, int len, int v,int zeros=0);
         unsigned char SegmentBitmap(char v);
-        void SendAllMeters();
-        void SendAllMetersLoop();
 
         PacketCallback m_packetCallBack;
+        std::function<void()> m_connectCallBack;
         EventCallback m_buttonCallBack;
         EventCallback m_dialCallBack;
         EventCallback m_faderStateCallBack;
         EventCallback m_faderCallBack;
 
+        std::chrono::microseconds m_packetGap = DEFAULT_PACKET_GAP;
+        std::chrono::steady_clock::time_point m_lastPacket;
+
         time_t mLastIdle;
         int mFullRefreshNeeded;
         xt_button_state_t mButtonLEDStates[127];
+        // Changes waiting for Flush
         bool m_dirty[127];
-        std::vector<xt_button_state_t*> mButtonLEDStack;
+        bool m_allButtonsDirty;
+        bool m_faderDirty[9];
+        bool m_dialDirty[8];
+        bool m_scribbleDirty[8];
+        bool m_segmentsDirty;
         
         unsigned char mMeterLevels[8];
         unsigned int mFaderLevels[9];
+        int mDialValues[8];
         unsigned char mSegmentCache[12];
 
         xt_ScribblePad_t mScribblePads[8];
-
-        std::thread m_soundMeterRefresh;
 };
 
 extern XTouch *g_xtouch;
\ No newline at end of file
@@ -5,27 +5,40 @@
 #include <assert.h>
 #include <delayed.h>
 #include <interface.h>
+#include <mailbox.h>
+#include <startup.h>
+#include <clock.h>
+#include <latency.h>
+#include <metrics.h>
+#include <trace.h>
 
 // Global pointer to the XTouch object
 // It is preferable to use a global pointer to the XTouch object 
 // as the XTouch methods for updating segments/dials/faders is used by all the individual physical display objects
 // and passing callbacks to each of these objects would either be beuracratic or convoluted.
 // This is a simple way to ensure that the XTouch object is available to all the physical display objects
-// The "proper" way to do this would be to use message passing/mailbox, but that is only necessary if our threading model
-// becomes more complex.
+// Only the controller thread (XTouchController::Run) may use it, other threads post commands to g_mailbox.
 XTouch *g_xtouch;
 DelayedExecuter *g_delayedThreadScheduler;
 InterfaceManager *g_interfaceManager;
+Mailbox *g_mailbox;
+StartupTimer *g_startup;
+Clock *g_clock;
+LatencyTracer *g_latency; // Set by the controller when XCTL_LATENCY_TRACE is set
+Metrics *g_metrics;
+Tracer *g_trace; // Set by the controller when XCTL_TRACE_FILE is set
 
 int main(int, char**) {
+   g_clock = new SteadyClock();
+   g_metrics = new Metrics();
+   g_startup = new StartupTimer();
    g_xtouch = new XTouch();
    g_delayedThreadScheduler = new DelayedExecuter();
    g_interfaceManager = new InterfaceManager(g_xtouch);
+   g_mailbox = new Mailbox();
    
    XTouchController controller;
-   while(true) {
-      std::this_thread::sleep_for(std::chrono::hours(24));
-   }
+   controller.Run();
    assert(false && "Should never reach here");
    return 0;
 }
\ No newline at end of file